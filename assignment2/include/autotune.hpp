@@ -0,0 +1,28 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+#include <string>
+#include "parse_utility.hpp"
+
+struct AutotuneResult {
+    SchedulingPolicy policy;
+    int task_size;
+    //true when read from the profile, false when measured now
+    bool cached;
+    //sequential cost of the sample and the time of the chosen configuration
+    //above the ideal sequential_time / num_threads (measured runs only)
+    double ns_per_element;
+    double overhead_ms;
+};
+
+//scheduling policy and task size for running_param.num_threads threads: read
+//from the profile file (one line per cpu model and thread count) when present,
+//otherwise every candidate is timed on a prefix of each range and the fastest
+//one is appended to the profile
+AutotuneResult autotune(const RunningParam &running_param);
+
+const char *policy_name(SchedulingPolicy policy);
+
+//"model name" of the first cpu in /proc/cpuinfo, without tabs
+string cpu_model();
+
+#endif //AUTOTUNE_HPP
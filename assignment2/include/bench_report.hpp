@@ -0,0 +1,69 @@
+#ifndef BENCH_REPORT_HPP
+#define BENCH_REPORT_HPP
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "parse_utility.hpp"
+
+//median of the runs and its 95% confidence interval, from the order
+//statistics of the sorted runs (no assumption on the distribution): with
+//fewer than 6 runs the interval is the whole [min, max]
+struct SampleSummary {
+    double median;
+    double ci_low;
+    double ci_high;
+};
+
+SampleSummary summarize(vector<double> runs);
+
+//one line of the report: runs in seconds, or in ns per chunk for the
+//dispatch overhead
+struct BenchMeasure {
+    string measure;         //sequential, parallel, speedup or dispatch
+    string policy;
+    vector<double> runs;
+    SampleSummary summary;
+    string unit;
+};
+
+//machine and build the measures were taken on
+struct BenchMachine {
+    string host;
+    string cpu;
+    unsigned hardware_threads;
+    string compiler;
+    string date;
+};
+
+BenchMachine bench_machine();
+
+//JSON object or CSV table (metadata as leading # lines) of the measures of
+//command, written to running_param.bench_output (stdout when empty)
+void write_bench_report(const RunningParam &running_param, const string &command,
+                        const vector<BenchMeasure> &measures);
+
+//seconds taken by each of runs calls of run, after warmup untimed calls;
+//prepare() is called, untimed, before every call of run
+template<typename Prepare, typename Run>
+vector<double> time_runs(int warmup, int runs, Prepare &&prepare, Run &&run) {
+    for (int i = 0; i < warmup; i++) {
+        prepare();
+        run();
+    }
+    vector<double> times;
+    for (int i = 0; i < runs; i++) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return times;
+}
+
+template<typename Run>
+vector<double> time_runs(int warmup, int runs, Run &&run) {
+    return time_runs(warmup, runs, [] {}, run);
+}
+
+#endif //BENCH_REPORT_HPP
@@ -1,7 +1,14 @@
 #ifndef BLOCK_CYCLIC_SCHEDULING_H
 #define BLOCK_CYCLIC_SCHEDULING_H
 #include <utility>
+#include "collatz_reducers.hpp"
+#include "scheduler.hpp"
+#include "thread_team.hpp"
 
-void execute_static_scheduling(int task_size, int num_threads,
-                               const std::pair<long, long> &range);
+//fold range with reducer, chunks of task_size elem dealt block-cyclically
+//to the team; instantiated for the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_static_scheduling(int task_size, ThreadTeam &team,
+                                                       const std::pair<long, long> &range,
+                                                       const Reducer &reducer);
 #endif //BLOCK_CYCLIC_SCHEDULING_H
@@ -0,0 +1,330 @@
+#ifndef BOUNDED_THREADPOOL_HPP
+#define BOUNDED_THREADPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <tuple>
+#include <immintrin.h>
+
+#include "chunked_reduce.hpp"
+#include "mpmc_queue.hpp"
+#include "pool_stats.hpp"
+#include "small_task.hpp"
+#include "thread_affinity.hpp"
+
+// Thread pool whose tasks live in a fixed-size lock-free ring
+// (BoundedMPMCQueue): memory does not depend on how many tasks are
+// submitted, and a producer that finds the ring full waits (backpressure)
+// until the workers have drained it to half its capacity. Idle workers
+// spin, then yield, then block; the mutex is only taken to block or to
+// wake-up a blocked thread. No priorities (see ThreadPool).
+class BoundedThreadPool {
+
+private:
+
+	using clock = std::chrono::steady_clock;
+
+	// enqueued is only stamped while stats are collected
+	struct QueuedTask {
+		SmallTask task;
+		clock::time_point enqueued;
+	};
+
+	// storage for threads and tasks
+	std::vector<std::thread> threads;
+	BoundedMPMCQueue<QueuedTask> tasks;
+
+	// primitives for signaling: not_empty for workers, not_full for
+	// producers, idle_cv for wait_all
+	std::mutex mutex;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+	std::condition_variable idle_cv;
+
+	// the state of the thread pool
+	std::atomic<bool> stop_pool;
+	// tasks submitted and not yet completed
+	std::atomic<int64_t> outstanding_tasks;
+	std::atomic<uint32_t> sleeping_threads;
+	std::atomic<uint32_t> blocked_producers;
+	const uint32_t capacity;
+
+	// idle workers poll the ring spin_iterations times (pause), then
+	// yield_iterations times (yield) before blocking
+	const uint32_t spin_iterations;
+	const uint32_t yield_iterations;
+
+	// per-worker counters, only recorded after enable_stats(true)
+	PoolStats stats;
+	std::atomic<bool> collect_stats;
+
+	// index of the calling thread within its pool, -1 outside
+	static int& worker_index() {
+		static thread_local int index = -1;
+		return index;
+	}
+
+	// custom task factory
+	template <typename Func, typename ... Args,
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
+	auto make_task(Func && func, Args && ...args) -> std::packaged_task<Rtrn(void)> {
+
+		auto aux = [func = std::forward<Func>(func),
+					args = std::make_tuple(std::forward<Args>(args)...)] ( ) mutable -> Rtrn {
+			return std::apply(func, args);
+		};
+
+		return std::packaged_task<Rtrn(void)>(std::move(aux));
+	}
+
+	static void cpu_relax() {
+		_mm_pause();
+	}
+
+	// wake-up blocked threads: taking the mutex orders the notification
+	// after a concurrent waiter has checked its predicate
+	void notify(std::condition_variable & cv, bool all) {
+		{ std::lock_guard<std::mutex> lock_guard(mutex); }
+		if (all)
+			cv.notify_all();
+		else
+			cv.notify_one();
+	}
+
+	// publish a task, waiting while the ring is full
+	void push_task(SmallTask && task) {
+		// you cannot reuse pool after being stopped
+		if (stop_pool.load())
+			throw std::runtime_error("enqueue on stopped BoundedThreadPool");
+
+		outstanding_tasks.fetch_add(1);
+		bool stamp = collect_stats.load(std::memory_order_relaxed);
+		QueuedTask queued{std::move(task), stamp ? clock::now() : clock::time_point()};
+		uint32_t yields = 0;
+		while (!tasks.try_push(std::move(queued))) {
+			if (yields < yield_iterations) {
+				std::this_thread::yield();
+				yields++;
+				continue;
+			}
+			std::unique_lock<std::mutex> unique_lock(mutex);
+			blocked_producers.fetch_add(1);
+			not_full.wait(unique_lock, [this] ( ) -> bool {
+				return tasks.size_hint() <= tasks.capacity() / 2;
+			});
+			blocked_producers.fetch_sub(1);
+		}
+		if (stamp)
+			stats.record_queue_depth(tasks.size_hint());
+
+		// pairs with the increment of sleeping_threads before a worker
+		// checks the ring: either it sees the task or we see it asleep
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleeping_threads.load(std::memory_order_relaxed) > 0)
+			notify(not_empty, false);
+	}
+
+	// extract a task: spin, then yield, then block while the ring is
+	// empty; false when woken up without getting one
+	bool pop_task(uint32_t id, QueuedTask & task) {
+		if (tasks.try_pop(task))
+			return true;
+		for (uint32_t spins = 0; spins < spin_iterations; spins++) {
+			cpu_relax();
+			if (tasks.try_pop(task))
+				return true;
+		}
+		for (uint32_t yields = 0; yields < yield_iterations; yields++) {
+			if (collect_stats.load(std::memory_order_relaxed))
+				stats.record_idle_spin(id);
+			std::this_thread::yield();
+			if (tasks.try_pop(task))
+				return true;
+		}
+
+		std::unique_lock<std::mutex> unique_lock(mutex);
+		auto predicate = [this] ( ) -> bool {
+			return stop_pool.load() || tasks.size_hint() > 0;
+		};
+		sleeping_threads.fetch_add(1);
+		if (!predicate() && collect_stats.load(std::memory_order_relaxed)) {
+			clock::time_point parked = clock::now();
+			not_empty.wait(unique_lock, predicate);
+			stats.record_idle(id, parked, clock::now());
+		} else {
+			not_empty.wait(unique_lock, predicate);
+		}
+		sleeping_threads.fetch_sub(1);
+		unique_lock.unlock();
+		return tasks.try_pop(task);
+	}
+
+	void wait_loop(uint32_t id) {
+		worker_index() = id;
+
+		while (true) {
+			QueuedTask queued;
+			if (!pop_task(id, queued)) {
+				// exit if thread pool stopped
+				// and no tasks to be performed
+				if (stop_pool.load() && tasks.size_hint() == 0)
+					return;
+				continue;
+			}
+
+			// a slot is free: resume the producers once half of the
+			// ring is (same fence pairing as in push_task)
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (blocked_producers.load(std::memory_order_relaxed) > 0 &&
+				tasks.size_hint() <= tasks.capacity() / 2)
+				notify(not_full, true);
+
+			if (queued.enqueued != clock::time_point() &&
+				collect_stats.load(std::memory_order_relaxed)) {
+				clock::time_point started = clock::now();
+				queued.task();
+				queued.task.reset();
+				stats.record_task(id, queued.enqueued, started, clock::now());
+			} else {
+				queued.task();
+				queued.task.reset();
+			}
+			if (outstanding_tasks.fetch_sub(1) == 1)
+				notify(idle_cv, true);
+		}
+	}
+
+public:
+	static constexpr uint32_t DEFAULT_QUEUE_CAPACITY = 1024;
+	static constexpr uint32_t DEFAULT_SPIN_ITERATIONS = 1 << 12;
+	static constexpr uint32_t DEFAULT_YIELD_ITERATIONS = 16;
+
+	// queue_capacity is rounded up to a power of two; as in ThreadPool,
+	// idle workers block right away when they outnumber the hardware threads
+	BoundedThreadPool(uint64_t capacity_, uint64_t queue_capacity = DEFAULT_QUEUE_CAPACITY,
+					  uint32_t spin_iterations_ = DEFAULT_SPIN_ITERATIONS,
+					  uint32_t yield_iterations_ = DEFAULT_YIELD_ITERATIONS) :
+		tasks(queue_capacity),
+		stop_pool(false), // pool is running
+		outstanding_tasks(0), // no work to be done
+		sleeping_threads(0),
+		blocked_producers(0),
+		capacity(capacity_), // remember size
+		spin_iterations(capacity_ > std::thread::hardware_concurrency() ? 0 : spin_iterations_),
+		yield_iterations(capacity_ > std::thread::hardware_concurrency() ? 0 : yield_iterations_),
+		stats(capacity_),
+		collect_stats(false) {
+
+		// initially spawn capacity many threads
+		for (uint64_t id = 0; id < capacity; id++)
+			threads.emplace_back(&BoundedThreadPool::wait_loop, this, id);
+	}
+
+	~BoundedThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock_guard(mutex);
+			stop_pool = true;
+		}
+
+		// signal all threads
+		not_empty.notify_all();
+
+		// finally join all threads
+		for (auto& thread : threads)
+			thread.join();
+
+		if (collect_stats.load())
+			stats.print(stdout, "BoundedThreadPool");
+	}
+
+	template <typename Func, typename ... Args,
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
+	auto enqueue(Func && func, Args && ... args) -> std::future<Rtrn> {
+
+		auto task = make_task(std::forward<Func>(func), std::forward<Args>(args)...);
+		auto future = task.get_future();
+
+		push_task(SmallTask(std::move(task)));
+
+		return future;
+	}
+
+	// fire-and-forget submission, see ThreadPool::submit: blocks while
+	// the ring is full
+	template <typename Func>
+	void submit(Func && func) {
+		push_task(SmallTask(std::forward<Func>(func)));
+	}
+
+	// block until every submitted task has completed
+	void wait_all() {
+		std::unique_lock<std::mutex> unique_lock(mutex);
+		idle_cv.wait(unique_lock, [this] ( ) -> bool {
+			return outstanding_tasks.load() == 0;
+		});
+	}
+
+	uint32_t size() const {
+		return capacity;
+	}
+
+	// collect per-worker latency/execution histograms, idle time and the
+	// maximum ring occupancy for the tasks submitted from now on; when
+	// enabled the summary is also printed at destruction
+	void enable_stats(bool enable) {
+		collect_stats.store(enable);
+	}
+
+	// merge the per-worker counters (can be called while running)
+	PoolStats::Summary stats_summary() const {
+		return stats.summary();
+	}
+
+	void print_stats(FILE * out = stdout) const {
+		stats.print(out, "BoundedThreadPool");
+	}
+
+	uint64_t queue_capacity() const {
+		return tasks.capacity();
+	}
+
+	// index of the calling worker in [0, size()), -1 outside the pool
+	static int current_worker() {
+		return worker_index();
+	}
+
+	// pin worker id to cpu_map[id % cpu_map.size()], false if
+	// some cpu could not be used
+	bool pin_workers(const std::vector<int> & cpu_map) {
+		bool pinned = true;
+		for (size_t id = 0; id < threads.size() && !cpu_map.empty(); id++)
+			pinned &= pin_thread(threads[id].native_handle(), cpu_map[id % cpu_map.size()]);
+		return pinned;
+	}
+
+	// run body(worker_id, first, last) over the inclusive range split in
+	// chunks of chunk elements, see ThreadPool::parallel_for
+	template <typename Body>
+	void parallel_for(const std::pair<long, long> &range, long chunk, Body && body) {
+		chunked_parallel_for(*this, range, chunk, std::forward<Body>(body));
+	}
+
+	template <typename Body, typename Reducer,
+			  typename Rtrn=std::invoke_result_t<Body, long, long>>
+	Rtrn parallel_for_reduce(const std::pair<long, long> &range, long chunk,
+							 Body && body, Reducer && reducer, Rtrn identity = Rtrn()) {
+		return chunked_parallel_for_reduce(*this, range, chunk,
+										   std::forward<Body>(body),
+										   std::forward<Reducer>(reducer), identity);
+	}
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CACHE_ALIGNED_HPP
+#define CACHE_ALIGNED_HPP
+
+#include <cstddef>
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Wrap a per-thread value so that it owns whole cache lines: neighbouring
+// slots of a vector<CacheAligned<T>> written by different threads never
+// share a line (no false sharing).
+template <typename T>
+struct alignas(CACHE_LINE_SIZE) CacheAligned {
+	T value;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CHUNK_BOUNDS_HPP
+#define CHUNK_BOUNDS_HPP
+
+#include <climits>
+
+// Last element of the chunk of size elements starting at first, clipped to
+// last (first <= last). The clip is decided on last - first, so first + size
+// is never computed when it would pass LONG_MAX.
+inline long chunk_last(long first, long size, long last) {
+	return last - first < size ? last : first + size - 1;
+}
+
+// Call f(n) for every n within [first, last], last can be LONG_MAX. The
+// common case keeps the plain n <= last loop, whose trip count the
+// compiler knows; only a range ending on LONG_MAX stops one short and does
+// last apart, since n <= LONG_MAX never fails.
+template <typename F>
+inline void for_each_in_range(long first, long last, F && f) {
+	if (first > last)
+		return;
+	if (last < LONG_MAX) {
+		for (long n = first; n <= last; n++)
+			f(n);
+		return;
+	}
+	for (long n = first; n < last; n++)
+		f(n);
+	f(last);
+}
+
+#endif
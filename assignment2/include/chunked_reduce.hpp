@@ -0,0 +1,70 @@
+#ifndef CHUNKED_REDUCE_HPP
+#define CHUNKED_REDUCE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cache_aligned.hpp"
+#include "chunk_bounds.hpp"
+
+// Bulk range submission shared by the thread pools: instead of one task
+// per chunk, pool.size() tasks are submitted and each of them claims chunks
+// of the inclusive range from a shared counter, calling
+// body(worker_id, first, last) for every chunk it gets. worker_id is in
+// [0, pool.size()) and is owned by one task: per-worker state indexed by
+// it needs no synchronization. Pool must provide submit(func), wait_all()
+// and size().
+template <typename Pool, typename Body>
+void chunked_parallel_for(Pool &pool, const std::pair<long, long> &range,
+						  long chunk, Body && body) {
+
+	const uint32_t num_workers = pool.size();
+	const long num_chunks = range.first <= range.second ?
+		(range.second - range.first) / chunk + 1 : 0;
+
+	std::atomic<long> next_chunk(0);
+
+	auto worker = [&] (uint32_t worker_id) -> void {
+		for (long c = next_chunk.fetch_add(1, std::memory_order_relaxed);
+			 c < num_chunks;
+			 c = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+			long first = range.first + c * chunk;
+			long last = chunk_last(first, chunk, range.second);
+			body(worker_id, first, last);
+		}
+	};
+
+	// the submitted closure only holds two words: it fits the
+	// inline storage of the task and does not allocate
+	for (uint32_t worker_id = 0; worker_id < num_workers; worker_id++)
+		pool.submit([&worker, worker_id] ( ) -> void { worker(worker_id); });
+	pool.wait_all();
+}
+
+// Same, folding body(first, last) into a cache-aligned partial per worker:
+// memory is O(threads) whatever the number of chunks. reducer must be
+// associative and identity its neutral element.
+template <typename Pool, typename Body, typename Reducer,
+		  typename Rtrn=std::invoke_result_t<Body, long, long>>
+Rtrn chunked_parallel_for_reduce(Pool &pool, const std::pair<long, long> &range,
+								 long chunk, Body && body, Reducer && reducer,
+								 Rtrn identity = Rtrn()) {
+
+	std::vector<CacheAligned<Rtrn>> partials(pool.size(), {identity});
+	chunked_parallel_for(pool, range, chunk,
+		[&] (uint32_t worker_id, long first, long last) -> void {
+			Rtrn &partial = partials[worker_id].value;
+			partial = reducer(partial, body(first, last));
+		});
+
+	Rtrn result = identity;
+	for (auto &partial : partials)
+		result = reducer(result, partial.value);
+	return result;
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef COLLATZ_CACHE_HPP
+#define COLLATZ_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "collatz_overflow.hpp"
+
+struct CollatzCacheStats {
+    long hits;              //trajectories cut short by a cached length
+    long hash_hits;         //hits served by the hash table
+    long misses;            //trajectories walked down to 1
+    long dense_entries;
+    long hash_entries;
+};
+
+// Collatz lengths memo table shared by all worker threads, filled
+// opportunistically while trajectories are computed:
+//  - a dense array of lengths for n < dense_bound;
+//  - an optional open-addressing table for bigger values, probed once per
+//    trajectory, when it first drops below its starting value (those
+//    starting values are the ones most likely to be already known).
+// Every slot is an independent atomic: concurrent writers store the same
+// value, readers see either the value or "unknown", so no lock is needed.
+// The hash is lossy: inserts that do not find a slot in a few probes are
+// dropped.
+class CollatzCache {
+    //lengths are stored +1 so that 0 means "unknown"
+    std::unique_ptr<std::atomic<uint16_t>[]> dense;
+    uint64_t dense_bound;
+
+    struct HashEntry {
+        std::atomic<uint64_t> key;
+        std::atomic<uint32_t> length;
+    };
+    std::unique_ptr<HashEntry[]> hash;
+    uint64_t hash_mask;
+    static constexpr int MAX_PROBES = 8;
+    //values visited before the first hit that are remembered for the fill
+    static constexpr int MAX_PATH = 256;
+
+    static uint64_t hash_slot(uint64_t n) {
+        return (n * 0x9E3779B97F4A7C15ull) >> 20;
+    }
+
+    long hash_lookup(uint64_t n) const;
+    void hash_insert(uint64_t n, long length);
+
+    long lookup(uint64_t n, uint64_t start, bool &hash_probed) const {
+        if (n < dense_bound) {
+            return static_cast<long>(dense[n].load(std::memory_order_relaxed)) - 1;
+        }
+        if (hash && n < start && !hash_probed) {
+            hash_probed = true;
+            return hash_lookup(n);
+        }
+        return -1;
+    }
+
+    //only starting values are hashed: those are the values later
+    //trajectories of an ascending sweep drop onto
+    void store(uint64_t n, long length, uint64_t start) {
+        if (n < dense_bound) {
+            dense[n].store(static_cast<uint16_t>(length + 1), std::memory_order_relaxed);
+        } else if (hash && n == start) {
+            hash_insert(n, length);
+        }
+    }
+
+public:
+    //budget_bytes is split between the dense array and, when use_hash is set,
+    //the hash table (half each); dense_bound, when positive, caps the array
+    CollatzCache(size_t budget_bytes, bool use_hash, long dense_bound = 0);
+
+    long length(long n);
+
+    //hit/miss counters of the threads that already exited are included
+    CollatzCacheStats stats() const;
+};
+
+//cache used by the scheduling policies, nullptr when memoization is disabled
+inline CollatzCache *collatz_cache = nullptr;
+
+//per-thread hit/miss counters, merged into the global ones at thread exit
+struct CollatzCacheCounters {
+    long hits = 0;
+    long hash_hits = 0;
+    long misses = 0;
+    ~CollatzCacheCounters();
+};
+extern thread_local CollatzCacheCounters collatz_cache_counters;
+
+inline long CollatzCache::length(long n) {
+    if (n < 1) {
+        return -1;
+    }
+    struct PathEntry {
+        uint64_t value;
+        long steps;
+    };
+    PathEntry path[MAX_PATH];
+    int path_size = 0;
+
+    const uint64_t start = n;
+    uint64_t value = n;
+    long steps = 0;
+    long total = -1;
+    bool hash_probed = false;
+    while (value != 1) {
+        long known = lookup(value, start, hash_probed);
+        if (known >= 0) {
+            total = steps + known;
+            collatz_cache_counters.hash_hits += value >= dense_bound;
+            break;
+        }
+        if (path_size < MAX_PATH && (value < dense_bound || (hash && value == start))) {
+            path[path_size++] = {value, steps};
+        }
+        if (value % 2 != 0 && value > COLLATZ_MAX_SAFE_ODD) {
+            //not cached: the trajectory is finished on 128 bits
+            steps += calculate_collatz_length_wide(value);
+            break;
+        }
+        value = (value % 2 == 0) ? value / 2 : 3 * value + 1;
+        steps++;
+    }
+
+    if (total >= 0) {
+        collatz_cache_counters.hits++;
+    } else {
+        collatz_cache_counters.misses++;
+        total = steps;
+    }
+
+    //remember the lengths of the values visited before the hit
+    for (int i = 0; i < path_size; i++) {
+        store(path[i].value, total - path[i].steps, start);
+    }
+    return total;
+}
+
+#endif //COLLATZ_CACHE_HPP
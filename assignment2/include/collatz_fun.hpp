@@ -1,9 +1,14 @@
 #ifndef COLLATZ_FUN_H
 #define COLLATZ_FUN_H
+#include <cstdint>
 #include <cstdio>
-#include <future>
 #include <vector>
 
+#include "chunk_bounds.hpp"
+#include "collatz_cache.hpp"
+#include "collatz_overflow.hpp"
+#include "collatz_sieve.hpp"
+#include "collatz_simd.hpp"
 #include "collatz_fun.hpp"
 #include "parse_utility.hpp"
 
@@ -14,22 +19,207 @@ inline long calculate_collatz_length(long n) {
     if (n < 1) {
         return -1;
     }
+    unsigned long value = n;
     long collatz_length = 0;
-    while (n != 1) {
-        n = (n % 2 == 0) ? n / 2 : 3 * n + 1;
+    while (value != 1) {
+        if (value % 2 == 0) {
+            value = value / 2;
+        } else if (value <= COLLATZ_MAX_SAFE_ODD) {
+            value = 3 * value + 1;
+        } else {
+            //3n+1 would overflow: finish the trajectory on 128 bits
+            return collatz_length + calculate_collatz_length_wide(value);
+        }
         collatz_length++;
     }
 
     return collatz_length;
 }
 
-// Get in input a vector of future and return the maximum values
-inline long reduce_to_global_maximum(vector<future<long>>& local_maximum_futures) {
-    long global_maximum = 0;
-    for (auto &future: local_maximum_futures) {
-        global_maximum = max(global_maximum, future.get());
+// Same length as calculate_collatz_length without the data-dependent branch:
+// every odd step 3n+1 is merged with all the halvings that follow it, which
+// are counted at once with a trailing-zeros count
+inline long calculate_collatz_length_shortcut(long n) {
+    if (n < 1) {
+        return -1;
+    }
+    unsigned long value = n;
+    long zeros = __builtin_ctzl(value);
+    value >>= zeros;
+    long collatz_length = zeros;
+    while (value != 1) {
+        if (value > COLLATZ_MAX_SAFE_ODD) {
+            return collatz_length + calculate_collatz_length_wide(value);
+        }
+        //value is odd here, so 3 * value + 1 is even
+        value = 3 * value + 1;
+        zeros = __builtin_ctzl(value);
+        value >>= zeros;
+        collatz_length += 1 + zeros;
+    }
+    return collatz_length;
+}
+
+// Precomputed k-step jumps of T(n) = n/2 (n even), (3n+1)/2 (n odd).
+// Writing n = a * 2^K + b, K applications of T give a * 3^c(b) + T^K(b),
+// with c(b) the number of odd steps taken by b, i.e. K + c(b) plain steps.
+// For n >= 2^K the trajectory cannot reach 1 before the K-th step, so the
+// jump never skips over the end; values below 2^K use a length table.
+// Jumps whose result would not fit in 64 bits go to the 128-bit path.
+struct CollatzStepTable {
+    static constexpr int K = 16;
+    static constexpr uint64_t SIZE = 1ul << K;
+
+    struct Jump {
+        uint32_t addend;      //T^K(b)
+        uint32_t odd_steps;   //c(b)
+    };
+    vector<Jump> jumps;
+    vector<uint16_t> small_length;
+    uint64_t pow3[K + 1];
+    //largest a such that a * 3^c + T^K(b) fits in 64 bits, per c
+    uint64_t max_safe_prefix[K + 1];
+
+    CollatzStepTable() : jumps(SIZE), small_length(SIZE, 0) {
+        pow3[0] = 1;
+        for (int i = 1; i <= K; i++) {
+            pow3[i] = 3 * pow3[i - 1];
+        }
+        for (int i = 0; i <= K; i++) {
+            max_safe_prefix[i] = (UINT64_MAX - UINT32_MAX) / pow3[i];
+        }
+        for (uint64_t b = 0; b < SIZE; b++) {
+            uint64_t value = b;
+            uint32_t odd_steps = 0;
+            for (int step = 0; step < K; step++) {
+                if (value % 2 == 0) {
+                    value = value / 2;
+                } else {
+                    value = (3 * value + 1) / 2;
+                    odd_steps++;
+                }
+            }
+            jumps[b] = {static_cast<uint32_t>(value), odd_steps};
+            small_length[b] = b > 0 ? calculate_collatz_length(b) : 0;
+        }
+    }
+};
+
+inline const CollatzStepTable &collatz_step_table() {
+    static const CollatzStepTable table;
+    return table;
+}
+
+inline long calculate_collatz_length_table(long n, const CollatzStepTable &table) {
+    if (n < 1) {
+        return -1;
+    }
+    uint64_t value = n;
+    long collatz_length = 0;
+    while (value >= CollatzStepTable::SIZE) {
+        const CollatzStepTable::Jump &jump = table.jumps[value & (CollatzStepTable::SIZE - 1)];
+        if ((value >> CollatzStepTable::K) > table.max_safe_prefix[jump.odd_steps]) {
+            return collatz_length + calculate_collatz_length_wide(value);
+        }
+        value = (value >> CollatzStepTable::K) * table.pow3[jump.odd_steps] + jump.addend;
+        collatz_length += CollatzStepTable::K + jump.odd_steps;
+    }
+    return collatz_length + table.small_length[value];
+}
+
+// Shortcut kernel that also returns the highest value reached by the
+// trajectory of n (n itself when it never rises): peaks are always the
+// 3n+1 successors of odd values. Peaks above 64 bits come from the wide path.
+inline long calculate_collatz_length_peak(long n, unsigned __int128 &peak) {
+    if (n < 1) {
+        peak = 0;
+        return -1;
+    }
+    unsigned long value = n;
+    peak = value;
+    long zeros = __builtin_ctzl(value);
+    value >>= zeros;
+    long collatz_length = zeros;
+    while (value != 1) {
+        if (value > COLLATZ_MAX_SAFE_ODD) {
+            return collatz_length + calculate_collatz_length_peak_wide(value, peak);
+        }
+        value = 3 * value + 1;
+        if (value > peak) {
+            peak = value;
+        }
+        zeros = __builtin_ctzl(value);
+        value >>= zeros;
+        collatz_length += 1 + zeros;
+    }
+    return collatz_length;
+}
+
+// kernel used by calculate_range_maximum, chosen once per run
+inline CollatzKernel collatz_kernel = PLAIN_KERNEL;
+
+template<typename LengthFun>
+inline long range_maximum(long first, long last, LengthFun length) {
+    long local_maximum = 0;
+    for_each_in_range(first, last, [&local_maximum, &length](long n) {
+        local_maximum = max(local_maximum, length(n));
+    });
+    return local_maximum;
+}
+
+// Return the maximum collatz length within [first, last], going through
+// the shared memo table when it is enabled, otherwise with the selected kernel
+inline long calculate_range_maximum(long first, long last) {
+    if (collatz_cache != nullptr) {
+        return range_maximum(first, last, [](long n) { return collatz_cache->length(n); });
+    }
+    switch (collatz_kernel) {
+        case SHORTCUT_KERNEL:
+            return range_maximum(first, last, calculate_collatz_length_shortcut);
+        case SIMD_KERNEL:
+            return calculate_range_maximum_simd(first, last);
+        case SIEVE_KERNEL:
+            return calculate_range_maximum_sieve(first, last);
+        case TABLE_KERNEL: {
+            const CollatzStepTable &table = collatz_step_table();
+            return range_maximum(first, last, [&table](long n) {
+                return calculate_collatz_length_table(n, table);
+            });
+        }
+        default:
+            return range_maximum(first, last, calculate_collatz_length);
+    }
+}
+
+// Call visit(n, length) for every n within [first, last] with the same
+// kernel choice as calculate_range_maximum. The simd kernel visits values
+// out of order and skips n < 1 (length -1).
+template<typename Visit>
+inline void for_each_collatz_length(long first, long last, Visit &&visit) {
+    if (collatz_cache != nullptr) {
+        for_each_in_range(first, last, [&visit](long n) { visit(n, collatz_cache->length(n)); });
+        return;
+    }
+    switch (collatz_kernel) {
+        case SHORTCUT_KERNEL:
+            for_each_in_range(first, last, [&visit](long n) { visit(n, calculate_collatz_length_shortcut(n)); });
+            break;
+        case SIMD_KERNEL:
+            for_each_length_simd(first, last, visit);
+            break;
+        case SIEVE_KERNEL:
+            for_each_length_sieve(first, last, visit);
+            break;
+        case TABLE_KERNEL: {
+            const CollatzStepTable &table = collatz_step_table();
+            for_each_in_range(first, last, [&visit, &table](long n) {
+                visit(n, calculate_collatz_length_table(n, table));
+            });
+            break;
+        }
+        default:
+            for_each_in_range(first, last, [&visit](long n) { visit(n, calculate_collatz_length(n)); });
     }
-    return global_maximum;
 }
 
 #endif //COLLATZ_FUN_H
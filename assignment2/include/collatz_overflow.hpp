@@ -0,0 +1,45 @@
+#ifndef COLLATZ_OVERFLOW_HPP
+#define COLLATZ_OVERFLOW_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// Largest odd value whose 3n+1 successor still fits in 64 bits: the kernels
+// check it on odd steps only and hand the rare trajectories climbing above
+// it over to the 128-bit path below.
+constexpr uint64_t COLLATZ_MAX_SAFE_ODD = (UINT64_MAX - 1) / 3;
+
+// Collatz length computed on 128-bit integers, used to finish trajectories
+// that would overflow 64 bits
+inline long calculate_collatz_length_wide(unsigned __int128 n) {
+    long collatz_length = 0;
+    while (n != 1) {
+        n = (n % 2 == 0) ? n / 2 : 3 * n + 1;
+        collatz_length++;
+    }
+    return collatz_length;
+}
+
+// Same, also raising peak to the highest value of the trajectory
+inline long calculate_collatz_length_peak_wide(unsigned __int128 n, unsigned __int128 &peak) {
+    long collatz_length = 0;
+    while (n != 1) {
+        n = (n % 2 == 0) ? n / 2 : 3 * n + 1;
+        peak = std::max(peak, n);
+        collatz_length++;
+    }
+    return collatz_length;
+}
+
+// Decimal representation (printf has no conversion for 128-bit integers)
+inline std::string uint128_to_string(unsigned __int128 n) {
+    std::string digits;
+    do {
+        digits.push_back(static_cast<char>('0' + static_cast<int>(n % 10)));
+        n /= 10;
+    } while (n != 0);
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+#endif //COLLATZ_OVERFLOW_HPP
@@ -0,0 +1,149 @@
+#ifndef COLLATZ_REDUCERS_HPP
+#define COLLATZ_REDUCERS_HPP
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include "collatz_fun.hpp"
+#include "reduction.hpp"
+
+// Reducers over collatz lengths (see reduction.hpp for the interface),
+// all of them computing lengths with the kernel selected for the run.
+
+//maximum length
+struct MaxReducer {
+    using value_type = long;
+
+    long identity() const { return 0; }
+
+    void accumulate(long &maximum, long first, long last) const {
+        maximum = max(maximum, calculate_range_maximum(first, last));
+    }
+
+    void combine(long &maximum, long other) const {
+        maximum = max(maximum, other);
+    }
+};
+
+//maximum length and the smallest n reaching it
+struct CollatzArgMax {
+    long length;
+    long n;
+};
+
+struct ArgMaxReducer {
+    using value_type = CollatzArgMax;
+
+    //n = LONG_MAX: nothing seen yet, any value wins
+    CollatzArgMax identity() const { return {-1, LONG_MAX}; }
+
+    //fold the length of n into best: values may come out of order (simd
+    //kernel, chunks of a worker), ties go to the smaller n
+    static void update(CollatzArgMax &best, long n, long length) {
+        if (length > best.length || (length == best.length && n < best.n)) {
+            best = {length, n};
+        }
+    }
+
+    void accumulate(CollatzArgMax &best, long first, long last) const {
+        for_each_collatz_length(first, last, [&best](long n, long length) {
+            update(best, n, length);
+        });
+    }
+
+    void combine(CollatzArgMax &best, const CollatzArgMax &other) const {
+        update(best, other.n, other.length);
+    }
+};
+
+//number of starting values per length: counts[length]
+struct HistogramReducer {
+    using value_type = vector<long>;
+
+    vector<long> identity() const { return {}; }
+
+    //count one starting value of the given length
+    static void count(vector<long> &counts, long length) {
+        if (length < 0) {
+            return;
+        }
+        if (static_cast<size_t>(length) >= counts.size()) {
+            counts.resize(length + 1, 0);
+        }
+        counts[length]++;
+    }
+
+    void accumulate(vector<long> &counts, long first, long last) const {
+        for_each_collatz_length(first, last, [&counts](long, long length) {
+            count(counts, length);
+        });
+    }
+
+    void combine(vector<long> &counts, const vector<long> &other) const {
+        if (other.size() > counts.size()) {
+            counts.resize(other.size(), 0);
+        }
+        for (size_t length = 0; length < other.size(); length++) {
+            counts[length] += other[length];
+        }
+    }
+};
+
+//number of accumulate calls, no collatz work at all: timing a policy with
+//it isolates the cost of handing out the chunks (--bench)
+struct ChunkCountReducer {
+    using value_type = long;
+
+    long identity() const { return 0; }
+
+    void accumulate(long &chunks, long, long) const {
+        chunks++;
+    }
+
+    void combine(long &chunks, long other) const {
+        chunks += other;
+    }
+};
+
+//everything -a reports about a range, gathered in a single pass
+struct CollatzStats {
+    CollatzArgMax longest;          //maximum length, smallest n reaching it
+    vector<long> histogram;         //number of starting values per length
+    unsigned __int128 peak;         //highest value reached by a trajectory
+    long peak_n;                    //smallest n reaching it
+};
+
+struct CollatzStatsReducer {
+    using value_type = CollatzStats;
+
+    CollatzStats identity() const { return {ArgMaxReducer().identity(), {}, 0, LONG_MAX}; }
+
+    //ties go to the smaller n, as in ArgMaxReducer
+    static void update_peak(CollatzStats &stats, long n, unsigned __int128 peak) {
+        if (peak > stats.peak || (peak == stats.peak && n < stats.peak_n)) {
+            stats.peak = peak;
+            stats.peak_n = n;
+        }
+    }
+
+    //uses its own peak-tracking kernel, whatever the kernel selected; the
+    //argmax and the histogram are folded as ArgMaxReducer and
+    //HistogramReducer do
+    void accumulate(CollatzStats &stats, long first, long last) const {
+        for_each_in_range(max(first, 1L), last, [&stats](long n) {
+            unsigned __int128 peak;
+            long length = calculate_collatz_length_peak(n, peak);
+            ArgMaxReducer::update(stats.longest, n, length);
+            HistogramReducer::count(stats.histogram, length);
+            update_peak(stats, n, peak);
+        });
+    }
+
+    void combine(CollatzStats &stats, const CollatzStats &other) const {
+        ArgMaxReducer().combine(stats.longest, other.longest);
+        HistogramReducer().combine(stats.histogram, other.histogram);
+        update_peak(stats, other.peak_n, other.peak);
+    }
+};
+
+#endif //COLLATZ_REDUCERS_HPP
@@ -0,0 +1,127 @@
+#ifndef COLLATZ_SIEVE_HPP
+#define COLLATZ_SIEVE_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "collatz_overflow.hpp"
+
+// Bulk evaluation of a contiguous range, one window of SIEVE_WINDOW values
+// at a time, ascending. The lengths of the window are kept in a small
+// table (uint16_t: 64KB, fits L2), so a trajectory only needs to be
+// followed until it drops below its starting value:
+//  - even n whose half is in the window: len(n) = len(n / 2) + 1
+//  - otherwise (3n+1)/2^k steps until the value falls below n, then the
+//    window table if the value is still in the window, else more steps
+//    until it falls within a read-only table of the first SIEVE_BASE
+//    lengths (2MB, built once with the same scheme and shared).
+
+constexpr long SIEVE_WINDOW = 1L << 15;
+constexpr long SIEVE_BASE = 1L << 20;
+
+//one odd step (3n+1) and the halvings that follow, value odd and safe
+inline void sieve_odd_step(uint64_t &value, long &length) {
+    value = 3 * value + 1;
+    long zeros = __builtin_ctzl(value);
+    value >>= zeros;
+    length += 1 + zeros;
+}
+
+inline std::vector<uint16_t> build_sieve_base() {
+    std::vector<uint16_t> table(SIEVE_BASE + 1);
+    table[1] = 0;
+    for (long n = 2; n <= SIEVE_BASE; n++) {
+        if ((n & 1) == 0) {
+            table[n] = table[n / 2] + 1;
+            continue;
+        }
+        uint64_t value = n;
+        long length = 0;
+        while (value >= static_cast<uint64_t>(n)) {
+            sieve_odd_step(value, length);
+        }
+        table[n] = static_cast<uint16_t>(length + table[value]);
+    }
+    return table;
+}
+
+inline const std::vector<uint16_t> &sieve_base_table() {
+    static const std::vector<uint16_t> table = build_sieve_base();
+    return table;
+}
+
+// Call visit(n, length) for every n within [first, last] in ascending
+// order; n < 1 has length -1
+template<typename Visit>
+inline void for_each_length_sieve(long first, long last, Visit &&visit) {
+    for (long n = first; n <= last && n < 1; n++) {
+        visit(n, -1L);
+    }
+    const std::vector<uint16_t> &base = sieve_base_table();
+    static thread_local std::vector<uint16_t> window(SIEVE_WINDOW);
+
+    //high and the next low are never computed past last: the range can end
+    //within a window of LONG_MAX
+    for (long low = std::max(first, 1L); low <= last; low += SIEVE_WINDOW) {
+        const long high = last - low >= SIEVE_WINDOW - 1 ? low + SIEVE_WINDOW - 1 : last;
+        auto sieve_one = [&](long n) {
+            long length;
+            if (n <= SIEVE_BASE) {
+                length = base[n];
+            } else if ((n & 1) == 0 && n / 2 >= low) {
+                length = window[n / 2 - low] + 1;
+            } else {
+                //strip the halvings, then odd steps until below n
+                uint64_t value = n;
+                long zeros = __builtin_ctzl(value);
+                value >>= zeros;
+                length = zeros;
+                while (value >= static_cast<uint64_t>(n) && value <= COLLATZ_MAX_SAFE_ODD) {
+                    sieve_odd_step(value, length);
+                }
+                if (value >= static_cast<uint64_t>(n)) {
+                    //3n+1 would overflow: finish on 128 bits
+                    length += calculate_collatz_length_wide(value);
+                } else if (value >= static_cast<uint64_t>(low)) {
+                    length += window[value - low];
+                } else {
+                    while (value > static_cast<uint64_t>(SIEVE_BASE) && value <= COLLATZ_MAX_SAFE_ODD) {
+                        sieve_odd_step(value, length);
+                    }
+                    length += value <= static_cast<uint64_t>(SIEVE_BASE) ? base[value]
+                                                                        : calculate_collatz_length_wide(value);
+                }
+            }
+            window[n - low] = static_cast<uint16_t>(length);
+            visit(n, length);
+        };
+        //n <= high would step past high == LONG_MAX: that window (the last
+        //one) stops one short and does high apart
+        if (high < LONG_MAX) {
+            for (long n = low; n <= high; n++) {
+                sieve_one(n);
+            }
+        } else {
+            for (long n = low; n < high; n++) {
+                sieve_one(n);
+            }
+            sieve_one(high);
+        }
+        if (high == last) {
+            break;
+        }
+    }
+}
+
+// Return the maximum collatz length within [first, last]
+inline long calculate_range_maximum_sieve(long first, long last) {
+    long local_maximum = 0;
+    for_each_length_sieve(first, last, [&local_maximum](long, long length) {
+        local_maximum = std::max(local_maximum, length);
+    });
+    return local_maximum;
+}
+
+#endif //COLLATZ_SIEVE_HPP
@@ -0,0 +1,193 @@
+#ifndef COLLATZ_SIMD_HPP
+#define COLLATZ_SIMD_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+
+#include "collatz_overflow.hpp"
+
+// Vectorized evaluation of a block of adjacent starting values: every lane
+// of a SIMD register follows one trajectory with the (3n+1)/2 shortcut, all
+// lanes advancing in lock-step without branches. When a lane reaches 1 its
+// length is retired and the lane is refilled with the next starting value
+// of the block, so lanes stay busy until the block runs out of values.
+// Lanes also leave the vector loop once their value reaches 2^62 (where
+// (3n+1)/2 could overflow): those trajectories are finished on 128 bits.
+
+//a lane is moved off the vector loop when any of these bits is set
+constexpr uint64_t SIMD_WIDE_BITS = 3ull << 62;
+
+struct SimdLaneCounters {
+    long active_lane_steps = 0;   //lane updates that advanced a live trajectory
+    long total_lane_steps = 0;    //lane updates issued (live or not)
+    ~SimdLaneCounters();
+};
+extern thread_local SimdLaneCounters simd_lane_counters;
+
+struct SimdLaneStats {
+    int lanes;
+    long active_lane_steps;
+    long total_lane_steps;
+};
+
+//counters of the threads that already exited plus the calling thread
+SimdLaneStats simd_lane_stats();
+
+#if defined(__AVX512F__)
+
+struct CollatzLanes {
+    static constexpr int LANES = 8;
+
+    // advance all lanes until a live one reaches 1 (or 2^62), return the
+    // number of iterations performed; dead lanes are stepped too but never read
+    static long run_until_retire(uint64_t *value, uint64_t *length, unsigned alive) {
+        const __m512i one = _mm512_set1_epi64(1);
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i two = _mm512_set1_epi64(2);
+        //v - 2 wraps around for v = 1: a single unsigned compare catches both
+        //the lanes that reached 1 and the ones at or above 2^62
+        const __m512i leave_bound = _mm512_set1_epi64((1ull << 62) - 2);
+        __m512i v = _mm512_load_si512(value);
+        __m512i len = _mm512_load_si512(length);
+        long iterations = 0;
+        while ((_mm512_cmpge_epu64_mask(_mm512_sub_epi64(v, two), leave_bound) & alive) == 0) {
+            __m512i odd = _mm512_and_si512(v, one);
+            //zero-masked form: the plain srli trips -Wmaybe-uninitialized on gcc 12
+            __m512i half = _mm512_maskz_srli_epi64(0xFF, v, 1);
+            //odd: v/2 + (v+1) = (3v+1)/2, even: v/2
+            __m512i odd_mask = _mm512_sub_epi64(zero, odd);
+            __m512i odd_part = _mm512_and_si512(_mm512_add_epi64(v, one), odd_mask);
+            v = _mm512_add_epi64(half, odd_part);
+            len = _mm512_add_epi64(len, _mm512_add_epi64(odd, one));
+            iterations++;
+        }
+        _mm512_store_si512(value, v);
+        _mm512_store_si512(length, len);
+        return iterations;
+    }
+};
+
+#elif defined(__AVX2__)
+
+struct CollatzLanes {
+    static constexpr int LANES = 4;
+
+    static long run_until_retire(uint64_t *value, uint64_t *length, unsigned alive) {
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(value));
+        __m256i len = _mm256_load_si256(reinterpret_cast<const __m256i *>(length));
+        long iterations = 0;
+        while (true) {
+            //movemask reads the top bit of each lane: lanes equal to 1 (all ones
+            //after the compare), with bit 63 set, or with bit 62 set (shifted up)
+            __m256i leaving = _mm256_or_si256(_mm256_cmpeq_epi64(v, one),
+                                              _mm256_or_si256(v, _mm256_slli_epi64(v, 1)));
+            if (_mm256_movemask_pd(_mm256_castsi256_pd(leaving)) & alive) {
+                break;
+            }
+            __m256i odd = _mm256_and_si256(v, one);
+            __m256i half = _mm256_srli_epi64(v, 1);
+            //all ones on odd lanes
+            __m256i odd_mask = _mm256_sub_epi64(zero, odd);
+            __m256i odd_part = _mm256_and_si256(_mm256_add_epi64(v, one), odd_mask);
+            v = _mm256_add_epi64(half, odd_part);
+            len = _mm256_add_epi64(len, _mm256_add_epi64(odd, one));
+            iterations++;
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i *>(value), v);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(length), len);
+        return iterations;
+    }
+};
+
+#else
+
+// no vector unit available: same driver, one lane
+struct CollatzLanes {
+    static constexpr int LANES = 1;
+
+    static long run_until_retire(uint64_t *value, uint64_t *length, unsigned alive) {
+        long iterations = 0;
+        while (*value != 1 && (*value & SIMD_WIDE_BITS) == 0) {
+            uint64_t odd = *value & 1;
+            *value = (*value >> 1) + ((*value + 1) & (0 - odd));
+            *length += odd + 1;
+            iterations++;
+        }
+        return iterations;
+    }
+};
+
+#endif
+
+// Call visit(n, length) for every n >= 1 within [first, last], computing
+// CollatzLanes::LANES trajectories at a time: the values are visited in
+// the order their lanes retire, not in ascending order
+template<typename Visit>
+inline void for_each_length_simd(long first, long last, Visit &&visit) {
+    constexpr int LANES = CollatzLanes::LANES;
+    alignas(64) uint64_t value[LANES];
+    alignas(64) uint64_t length[LANES];
+    long start[LANES];
+
+    long next = std::max(first, 1L);
+    //next is not advanced past last, which can be LONG_MAX
+    bool pending = next <= last;
+    auto take_next = [&next, &pending, last] {
+        long n = next;
+        if (n == last) {
+            pending = false;
+        } else {
+            next++;
+        }
+        return n;
+    };
+    unsigned alive = 0;
+    for (int lane = 0; lane < LANES; lane++) {
+        length[lane] = 0;
+        value[lane] = 1;
+        if (pending) {
+            start[lane] = take_next();
+            value[lane] = start[lane];
+            alive |= 1u << lane;
+        }
+    }
+
+    while (alive != 0) {
+        long iterations = CollatzLanes::run_until_retire(value, length, alive);
+        simd_lane_counters.active_lane_steps += iterations * __builtin_popcount(alive);
+        simd_lane_counters.total_lane_steps += iterations * LANES;
+
+        //retire finished lanes and refill them with the next starting values
+        for (int lane = 0; lane < LANES; lane++) {
+            if ((alive >> lane & 1) && (value[lane] & SIMD_WIDE_BITS)) {
+                length[lane] += calculate_collatz_length_wide(value[lane]);
+                value[lane] = 1;
+            }
+            if ((alive >> lane & 1) && value[lane] == 1) {
+                visit(start[lane], static_cast<long>(length[lane]));
+                length[lane] = 0;
+                if (pending) {
+                    start[lane] = take_next();
+                    value[lane] = start[lane];
+                } else {
+                    alive &= ~(1u << lane);
+                }
+            }
+        }
+    }
+}
+
+// Return the maximum collatz length within [first, last]
+inline long calculate_range_maximum_simd(long first, long last) {
+    //n < 1 is not visited: it has length -1, it never raises the maximum
+    long local_maximum = 0;
+    for_each_length_simd(first, last, [&local_maximum](long, long length) {
+        local_maximum = std::max(local_maximum, length);
+    });
+    return local_maximum;
+}
+
+#endif //COLLATZ_SIMD_HPP
@@ -0,0 +1,259 @@
+#ifndef CORO_TASK_HPP
+#define CORO_TASK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Lazy coroutine producing a T. A CoroTask does not start until it is
+// awaited, and when it ends it resumes its awaiter by symmetric transfer:
+// a chain of co_await never blocks a thread nor grows the stack. Children
+// are spread over a pool with when_all, and the parent is resumed by the
+// thread that completes the last child, so no worker ever waits on a
+// future (nested fork/join cannot deadlock the pool). Pool must provide
+// submit(func).
+template <typename T>
+class CoroTask {
+
+public:
+	struct promise_type;
+	using handle = std::coroutine_handle<promise_type>;
+
+	struct promise_type {
+		std::optional<T> value;
+		std::exception_ptr exception;
+		std::coroutine_handle<> continuation;
+		// set by when_all: only the last child to finish resumes the parent
+		std::atomic<int> *pending_siblings = nullptr;
+
+		struct FinalAwaiter {
+			bool await_ready() noexcept {
+				return false;
+			}
+
+			std::coroutine_handle<> await_suspend(handle coroutine) noexcept {
+				promise_type &promise = coroutine.promise();
+				if (promise.pending_siblings != nullptr &&
+					promise.pending_siblings->fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return std::noop_coroutine();
+				if (promise.continuation)
+					return promise.continuation;
+				return std::noop_coroutine();
+			}
+
+			void await_resume() noexcept {}
+		};
+
+		CoroTask get_return_object() {
+			return CoroTask(handle::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+
+		FinalAwaiter final_suspend() noexcept {
+			return {};
+		}
+
+		template <typename U>
+		void return_value(U && result) {
+			value.emplace(std::forward<U>(result));
+		}
+
+		void unhandled_exception() {
+			exception = std::current_exception();
+		}
+	};
+
+private:
+	handle coroutine;
+
+	explicit CoroTask(handle coroutine_) : coroutine(coroutine_) {}
+
+public:
+	CoroTask(CoroTask && other) noexcept : coroutine(std::exchange(other.coroutine, {})) {}
+
+	CoroTask& operator=(CoroTask && other) noexcept {
+		if (this != &other) {
+			if (coroutine)
+				coroutine.destroy();
+			coroutine = std::exchange(other.coroutine, {});
+		}
+		return *this;
+	}
+
+	CoroTask(const CoroTask &) = delete;
+	CoroTask& operator=(const CoroTask &) = delete;
+
+	~CoroTask() {
+		if (coroutine)
+			coroutine.destroy();
+	}
+
+	handle get_handle() const {
+		return coroutine;
+	}
+
+	// result of a completed task (rethrows its exception)
+	T take_result() {
+		promise_type &promise = coroutine.promise();
+		if (promise.exception)
+			std::rethrow_exception(promise.exception);
+		return std::move(*promise.value);
+	}
+
+	// co_await task: run it on the awaiting thread, resume the awaiter after
+	auto operator co_await() & noexcept {
+		struct Awaiter {
+			CoroTask &task;
+
+			bool await_ready() noexcept {
+				return false;
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+				task.coroutine.promise().continuation = awaiter;
+				return task.coroutine;
+			}
+
+			T await_resume() {
+				return task.take_result();
+			}
+		};
+		return Awaiter{*this};
+	}
+
+	auto operator co_await() && noexcept {
+		return operator co_await();
+	}
+};
+
+// co_await schedule_on(pool): continue the coroutine as a task of pool
+template <typename Pool>
+auto schedule_on(Pool &pool) {
+	struct Awaiter {
+		Pool &pool;
+
+		bool await_ready() noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> coroutine) {
+			pool.submit([coroutine] ( ) -> void { coroutine.resume(); });
+		}
+
+		void await_resume() noexcept {}
+	};
+	return Awaiter{pool};
+}
+
+template <typename Pool, typename T>
+struct StartAllAwaiter {
+	Pool &pool;
+	std::vector<CoroTask<T>> &tasks;
+	std::atomic<int> pending;
+
+	StartAllAwaiter(Pool &pool_, std::vector<CoroTask<T>> &tasks_) :
+		pool(pool_), tasks(tasks_), pending(tasks_.size()) {}
+
+	bool await_ready() noexcept {
+		return tasks.empty();
+	}
+
+	// all the children but the last go to the pool, the last one runs
+	// right away on this thread; the handles are copied first since the
+	// parent (and tasks) may be gone as soon as the last child is started
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) {
+		std::vector<std::coroutine_handle<>> children;
+		children.reserve(tasks.size());
+		for (CoroTask<T> &task : tasks) {
+			task.get_handle().promise().continuation = parent;
+			task.get_handle().promise().pending_siblings = &pending;
+			children.push_back(task.get_handle());
+		}
+		for (size_t c = 0; c + 1 < children.size(); c++)
+			pool.submit([child = children[c]] ( ) -> void { child.resume(); });
+		return children.back();
+	}
+
+	void await_resume() noexcept {}
+};
+
+// run tasks concurrently on pool and fold their results, in order, into
+// identity with combine(acc, result)
+template <typename Pool, typename T, typename Combine>
+CoroTask<T> when_all(Pool &pool, std::vector<CoroTask<T>> tasks, T identity, Combine combine) {
+	co_await StartAllAwaiter<Pool, T>(pool, tasks);
+	T result = std::move(identity);
+	for (CoroTask<T> &task : tasks)
+		combine(result, task.take_result());
+	co_return result;
+}
+
+// coroutine that starts suspended and frees itself when it ends
+struct DetachedCoroutine {
+	struct promise_type {
+		DetachedCoroutine get_return_object() {
+			return {std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept {
+			return {};
+		}
+
+		void return_void() {}
+
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+
+	std::coroutine_handle<promise_type> coroutine;
+};
+
+struct SyncWaitState {
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool done = false;
+	std::exception_ptr exception;
+};
+
+template <typename T>
+DetachedCoroutine sync_wait_body(CoroTask<T> &task, std::optional<T> &result, SyncWaitState &state) {
+	try {
+		result.emplace(co_await task);
+	} catch (...) {
+		state.exception = std::current_exception();
+	}
+	std::lock_guard<std::mutex> lock_guard(state.mutex);
+	state.done = true;
+	state.cv.notify_one();
+}
+
+// run task on pool and block the calling thread (not a worker of pool)
+// until its result is ready
+template <typename Pool, typename T>
+T sync_wait(Pool &pool, CoroTask<T> task) {
+	std::optional<T> result;
+	SyncWaitState state;
+	DetachedCoroutine body = sync_wait_body(task, result, state);
+	pool.submit([coroutine = body.coroutine] ( ) -> void { coroutine.resume(); });
+
+	std::unique_lock<std::mutex> unique_lock(state.mutex);
+	state.cv.wait(unique_lock, [&state] ( ) -> bool { return state.done; });
+	if (state.exception)
+		std::rethrow_exception(state.exception);
+	return std::move(*result);
+}
+
+#endif
@@ -1,7 +1,28 @@
 #ifndef DYNAMIC_TP_SCHEDULING_H
 #define DYNAMIC_TP_SCHEDULING_H
+#include <boundedThreadPool.hpp>
 #include <threadPool.hpp>
+#include <workStealingThreadPool.hpp>
+#include "collatz_reducers.hpp"
+#include "parse_utility.hpp"
 
-void execute_dynamic_TP_scheduling(int task_size, ThreadPool &tp,
-                                   const std::pair<long, long> &range);
+//fold range with reducer on the pool, per chunk tasks of task_size elem or
+//bulk submission; instantiated for the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, ThreadPool &tp,
+                                                           const std::pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail = 0);
+
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, WorkStealingThreadPool &tp,
+                                                           const std::pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail = 0);
+
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, BoundedThreadPool &tp,
+                                                           const std::pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail = 0);
 #endif //DYNAMIC_TP_SCHEDULING_H
@@ -1,19 +1,14 @@
 #ifndef DYNAMIC_INDEX_SCHEDULING_HPP
 #define DYNAMIC_INDEX_SCHEDULING_HPP
-#include <mutex>
 #include <utility>
+#include "collatz_reducers.hpp"
+#include "scheduler.hpp"
+#include "thread_team.hpp"
 
-class ChunkDispatcher {
-    std::pair<long, long> range;
-    long task_size;
-    long current_index;
-    std::mutex _mutex;
-
-    public:
-    ChunkDispatcher(std::pair<long, long> range, long task_size);
-    std::pair<long, long> next_chunk();
-};
-
-void execute_dynamic_index_scheduling(int task_size, int num_threads,
-                                      const std::pair<long, long> &range);
+//fold range with reducer, chunks of task_size elem claimed by the team
+//from the dispatcher; instantiated for the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_index_scheduling(int task_size, ThreadTeam &team,
+                                                              const std::pair<long, long> &range,
+                                                              const Reducer &reducer);
 #endif
@@ -0,0 +1,18 @@
+#ifndef HIERARCHICAL_SCHEDULING_HPP
+#define HIERARCHICAL_SCHEDULING_HPP
+#include <utility>
+#include "collatz_reducers.hpp"
+#include "scheduler.hpp"
+#include "thread_team.hpp"
+
+// one group per NUMA node/socket, and at least one per 8 threads
+int default_dispatch_groups(int num_threads);
+
+//fold range with reducer, chunks of task_size elem claimed by the team
+//through a HierarchicalDispatcher with num_groups groups; instantiated for
+//the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_hierarchical_scheduling(int task_size, int num_groups, ThreadTeam &team,
+                                                             const std::pair<long, long> &range,
+                                                             const Reducer &reducer);
+#endif //HIERARCHICAL_SCHEDULING_HPP
@@ -0,0 +1,107 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "cache_aligned.hpp"
+
+// Bounded lock-free multi-producer multi-consumer FIFO (D. Vyukov's array
+// queue). Every cell carries a sequence number telling whether it is ready
+// to be written (sequence == position) or read (sequence == position + 1):
+// producers and consumers claim positions with a CAS on their own counter
+// and never touch the same cell at the same time. The capacity is rounded
+// up to a power of two and fixed: try_push fails instead of growing.
+template <typename T>
+class BoundedMPMCQueue {
+
+private:
+	struct Cell {
+		std::atomic<std::size_t> sequence;
+		T data;
+	};
+
+	const std::size_t mask;
+	std::unique_ptr<Cell[]> cells;
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueue_pos;
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> dequeue_pos;
+
+	static std::size_t round_up_pow2(std::size_t n) {
+		std::size_t size = 2;
+		while (size < n)
+			size <<= 1;
+		return size;
+	}
+
+public:
+	explicit BoundedMPMCQueue(std::size_t capacity) :
+		mask(round_up_pow2(capacity) - 1),
+		cells(new Cell[mask + 1]),
+		enqueue_pos(0),
+		dequeue_pos(0) {
+		for (std::size_t i = 0; i <= mask; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	std::size_t capacity() const {
+		return mask + 1;
+	}
+
+	// false if the queue is full (item is left untouched)
+	bool try_push(T && item) {
+		std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		Cell *cell;
+		while (true) {
+			cell = &cells[pos & mask];
+			std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+			if (diff == 0) {
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				// the cell still holds the item of the previous lap
+				return false;
+			} else {
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		cell->data = std::move(item);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// false if the queue is empty
+	bool try_pop(T & item) {
+		std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		Cell *cell;
+		while (true) {
+			cell = &cells[pos & mask];
+			std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+			if (diff == 0) {
+				if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		item = std::move(cell->data);
+		cell->sequence.store(pos + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	// claimed positions not yet claimed by a consumer: only a hint while
+	// other threads are pushing or popping
+	std::size_t size_hint() const {
+		std::size_t tail = dequeue_pos.load(std::memory_order_seq_cst);
+		std::size_t head = enqueue_pos.load(std::memory_order_seq_cst);
+		return head > tail ? head - tail : 0;
+	}
+};
+
+#endif
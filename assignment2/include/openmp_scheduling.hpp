@@ -0,0 +1,16 @@
+#ifndef OPENMP_SCHEDULING_HPP
+#define OPENMP_SCHEDULING_HPP
+#include <utility>
+#include "collatz_reducers.hpp"
+#include "parse_utility.hpp"
+
+//fold range with reducer in an OpenMP parallel region of num_threads
+//threads: the chunks of task_size elem are the iterations of an omp for with
+//schedule(kind, 1), so static is block-cyclic as -s and dynamic claims
+//chunks as -d; instantiated for the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_openmp_scheduling(int task_size, int num_threads, OpenMPSchedule kind,
+                                                       const std::pair<long, long> &range,
+                                                       const Reducer &reducer);
+
+#endif //OPENMP_SCHEDULING_HPP
@@ -0,0 +1,15 @@
+#ifndef PARALLEL_STL_SCHEDULING_HPP
+#define PARALLEL_STL_SCHEDULING_HPP
+#include <utility>
+#include "collatz_reducers.hpp"
+
+//fold range with reducer through std::transform_reduce(std::execution::par)
+//over the chunks of task_size elem: the library (TBB with libstdc++) decides
+//how the chunks are split among at most num_threads threads; instantiated
+//for the reducers of collatz_reducers.hpp
+template<typename Reducer>
+typename Reducer::value_type execute_parallel_stl_scheduling(int task_size, int num_threads,
+                                                             const std::pair<long, long> &range,
+                                                             const Reducer &reducer);
+
+#endif //PARALLEL_STL_SCHEDULING_HPP
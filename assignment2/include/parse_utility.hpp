@@ -3,19 +3,102 @@
 #include <string>
 #include <utility>
 #include <vector>
+#include "thread_affinity.hpp"
 
 using namespace std;
 
 enum SchedulingPolicy {
     STATIC_BLOCK_CYCLING,
     DYNAMIC_THREAD_POOL,
-    DYNAMIC_WITH_INDEX
+    DYNAMIC_WITH_INDEX,
+    HIERARCHICAL_INDEX,     //per-group chunk counters with stealing between groups
+    OPENMP_LOOP,            //omp for over the chunks (-o static|dynamic|guided)
+    PARALLEL_STL            //std::transform_reduce(std::execution::par) over the chunks
+};
+
+//schedule kind of the omp for of OPENMP_LOOP
+enum OpenMPSchedule {
+    OMP_STATIC,
+    OMP_DYNAMIC,
+    OMP_GUIDED
+};
+
+//function used to compute the length of a single collatz sequence
+enum CollatzKernel {
+    PLAIN_KERNEL,       //one step per iteration
+    SHORTCUT_KERNEL,    //odd step and following halvings at once (ctz)
+    TABLE_KERNEL,       //16 steps of (3n+1)/2 per lookup in a precomputed table
+    SIMD_KERNEL,        //adjacent values in the lanes of a vector register
+    SIEVE_KERNEL        //windows of adjacent values reusing the lengths already in the window
+};
+
+//how the thread pool policy hands the range over to the pool
+enum TPSubmission {
+    PER_CHUNK_TASKS,
+    BULK_RANGE,
+    LAZY_CHUNK_TASKS,   //few chunk tasks in flight, each one submits the next chunk
+    COROUTINE_SPLIT     //recursive halving, halves joined by coroutines (when_all)
+};
+
+//format of the --bench report
+enum BenchFormat {
+    JSON_REPORT,
+    CSV_REPORT
 };
 
 struct RunningParam {
     int num_threads;
     int task_size;
     SchedulingPolicy scheduling_policy;
+    //use the work-stealing pool instead of the single-queue ThreadPool
+    bool work_stealing;
+    TPSubmission tp_submission;
+    //memo table: total budget in MB (0 = disabled), optional hash for values
+    //above the dense array and optional cap on the dense array size
+    long cache_budget_mb;
+    bool cache_hash;
+    long cache_dense_bound;
+    bool verbose;
+    CollatzKernel kernel;
+    //process all the ranges in one parallel region instead of one per range
+    bool batch_ranges;
+    //report argmax, length histogram and peak value instead of the maximum only
+    bool statistics;
+    //groups of the hierarchical dispatcher (0 = one per NUMA node/socket,
+    //at least one per 8 threads)
+    int dispatch_groups;
+    //collect thread pool stats (latency/execution histograms, steals, idle
+    //time, queue depth) and print them when the pool is destroyed
+    bool pool_stats;
+    //pause iterations of an idle ThreadPool/BoundedThreadPool worker before
+    //it yields and then blocks (-1 = pool default, 0 = block right away)
+    long wait_spins;
+    //run the thread pool policy on the bounded lock-free queue of this many
+    //tasks (0 = unbounded ThreadPool queue)
+    long queue_capacity;
+    //--autotune: policy and task size from the profile file (keyed by cpu
+    //model and thread count), measured on a prefix of the ranges if missing
+    bool autotune;
+    string profile_path;
+    //--bench N: time warm-up + N runs of the policy, of the sequential loop
+    //and of the policy with empty chunks, and report them instead of the
+    //maxima (0 = normal run)
+    int bench_runs;
+    int bench_warmup;
+    BenchFormat bench_format;
+    string bench_output;
+    //--trace FILE: chunk, pool task and idle spans of every thread, written
+    //as Chrome trace JSON at exit (empty = no tracing)
+    string trace_path;
+    //thread placement, cpu_list holds the cpus of LIST_PINNING
+    ThreadPinning pinning;
+    vector<int> cpu_list;
+    //-o: schedule kind of the OpenMP backend
+    OpenMPSchedule omp_schedule;
+    //-P N: the last N chunks of every range go to the high priority queue
+    //of the ThreadPool (-t with per-chunk tasks), the others stay at normal
+    //priority: -v reports the queue wait of both levels
+    long priority_tail;
     vector<pair<long, long> > ranges;
 };
 
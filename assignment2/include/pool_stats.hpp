@@ -0,0 +1,194 @@
+#ifndef POOL_STATS_HPP
+#define POOL_STATS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "cache_aligned.hpp"
+
+// Opt-in instrumentation shared by the thread pools. Every worker owns a
+// cache-aligned block of counters that only it writes (relaxed load+store,
+// no read-modify-write), so recording costs a few plain stores plus the
+// clock reads; summary() merges the blocks on demand, while the pool runs.
+class PoolStats {
+
+public:
+	using clock = std::chrono::steady_clock;
+
+	// durations are binned by log2 of their length in nanoseconds
+	static constexpr int HISTOGRAM_BUCKETS = 40;
+
+	struct Summary {
+		uint64_t tasks;
+		uint64_t total_latency_ns;		// enqueue to start
+		uint64_t max_latency_ns;
+		uint64_t total_exec_ns;
+		uint64_t max_exec_ns;
+		uint64_t idle_ns;				// parked waiting for work
+		uint64_t idle_spins;			// empty polls before parking
+		uint64_t steals;				// tasks taken from another worker
+		uint64_t steal_attempts;
+		uint64_t max_queue_depth;
+		uint64_t latency_histogram[HISTOGRAM_BUCKETS];
+		uint64_t exec_histogram[HISTOGRAM_BUCKETS];
+		std::vector<uint64_t> tasks_per_worker;
+	};
+
+private:
+	struct Counters {
+		std::atomic<uint64_t> tasks{0};
+		std::atomic<uint64_t> total_latency_ns{0};
+		std::atomic<uint64_t> max_latency_ns{0};
+		std::atomic<uint64_t> total_exec_ns{0};
+		std::atomic<uint64_t> max_exec_ns{0};
+		std::atomic<uint64_t> idle_ns{0};
+		std::atomic<uint64_t> idle_spins{0};
+		std::atomic<uint64_t> steals{0};
+		std::atomic<uint64_t> steal_attempts{0};
+		std::atomic<uint64_t> latency_histogram[HISTOGRAM_BUCKETS] = {};
+		std::atomic<uint64_t> exec_histogram[HISTOGRAM_BUCKETS] = {};
+	};
+
+	std::unique_ptr<CacheAligned<Counters>[]> workers;
+	const uint32_t num_workers;
+	// updated by the submitting threads
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> max_queue_depth;
+
+	// single-writer increment
+	static void add(std::atomic<uint64_t> & counter, uint64_t value) {
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	static void raise(std::atomic<uint64_t> & counter, uint64_t value) {
+		if (value > counter.load(std::memory_order_relaxed))
+			counter.store(value, std::memory_order_relaxed);
+	}
+
+	static int bucket(uint64_t ns) {
+		int log2 = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+		return std::min(log2, HISTOGRAM_BUCKETS - 1);
+	}
+
+	static uint64_t elapsed_ns(clock::time_point from, clock::time_point to) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+	}
+
+	// "512ns", "4us", "1ms"... lower bound of a histogram bucket
+	static void print_bucket(FILE * out, int bucket) {
+		uint64_t ns = 1ull << bucket;
+		if (ns < 1000)
+			fprintf(out, " %luns", (unsigned long) ns);
+		else if (ns < 1000000)
+			fprintf(out, " %luus", (unsigned long) (ns / 1000));
+		else
+			fprintf(out, " %lums", (unsigned long) (ns / 1000000));
+	}
+
+	static void print_histogram(FILE * out, const char * name, const uint64_t * histogram) {
+		fprintf(out, "  %s histogram (bucket lower bound:tasks):", name);
+		for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+			if (histogram[b] > 0) {
+				print_bucket(out, b);
+				fprintf(out, ":%lu", (unsigned long) histogram[b]);
+			}
+		}
+		fprintf(out, "\n");
+	}
+
+public:
+	explicit PoolStats(uint32_t num_workers_) :
+		workers(new CacheAligned<Counters>[num_workers_]),
+		num_workers(num_workers_),
+		max_queue_depth(0) {}
+
+	// called by the thread that queued a task, with the depth after the push
+	void record_queue_depth(uint64_t depth) {
+		uint64_t current = max_queue_depth.load(std::memory_order_relaxed);
+		while (depth > current &&
+			   !max_queue_depth.compare_exchange_weak(current, depth, std::memory_order_relaxed));
+	}
+
+	// the recording functions below are called by worker id only
+
+	void record_task(uint32_t id, clock::time_point enqueued, clock::time_point started,
+					 clock::time_point finished) {
+		Counters & counters = workers[id].value;
+		uint64_t latency_ns = elapsed_ns(enqueued, started);
+		uint64_t exec_ns = elapsed_ns(started, finished);
+		add(counters.tasks, 1);
+		add(counters.total_latency_ns, latency_ns);
+		raise(counters.max_latency_ns, latency_ns);
+		add(counters.latency_histogram[bucket(latency_ns)], 1);
+		add(counters.total_exec_ns, exec_ns);
+		raise(counters.max_exec_ns, exec_ns);
+		add(counters.exec_histogram[bucket(exec_ns)], 1);
+	}
+
+	void record_idle(uint32_t id, clock::time_point parked, clock::time_point woken) {
+		add(workers[id].value.idle_ns, elapsed_ns(parked, woken));
+	}
+
+	void record_idle_spin(uint32_t id) {
+		add(workers[id].value.idle_spins, 1);
+	}
+
+	void record_steal_attempt(uint32_t id, bool success) {
+		add(workers[id].value.steal_attempts, 1);
+		if (success)
+			add(workers[id].value.steals, 1);
+	}
+
+	// merge the counters of all the workers (on demand, while running too)
+	Summary summary() const {
+		Summary total{};
+		for (uint32_t id = 0; id < num_workers; id++) {
+			const Counters & counters = workers[id].value;
+			uint64_t tasks = counters.tasks.load(std::memory_order_relaxed);
+			total.tasks += tasks;
+			total.tasks_per_worker.push_back(tasks);
+			total.total_latency_ns += counters.total_latency_ns.load(std::memory_order_relaxed);
+			total.max_latency_ns = std::max(total.max_latency_ns,
+				counters.max_latency_ns.load(std::memory_order_relaxed));
+			total.total_exec_ns += counters.total_exec_ns.load(std::memory_order_relaxed);
+			total.max_exec_ns = std::max(total.max_exec_ns,
+				counters.max_exec_ns.load(std::memory_order_relaxed));
+			total.idle_ns += counters.idle_ns.load(std::memory_order_relaxed);
+			total.idle_spins += counters.idle_spins.load(std::memory_order_relaxed);
+			total.steals += counters.steals.load(std::memory_order_relaxed);
+			total.steal_attempts += counters.steal_attempts.load(std::memory_order_relaxed);
+			for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+				total.latency_histogram[b] += counters.latency_histogram[b].load(std::memory_order_relaxed);
+				total.exec_histogram[b] += counters.exec_histogram[b].load(std::memory_order_relaxed);
+			}
+		}
+		total.max_queue_depth = max_queue_depth.load(std::memory_order_relaxed);
+		return total;
+	}
+
+	void print(FILE * out, const char * pool_name) const {
+		Summary total = summary();
+		double tasks = total.tasks > 0 ? total.tasks : 1;
+		fprintf(out, "%s stats: %u workers, %lu tasks, max queue depth %lu\n", pool_name,
+				num_workers, (unsigned long) total.tasks, (unsigned long) total.max_queue_depth);
+		fprintf(out, "  enqueue->start latency: mean %.2f us, max %.2f us\n",
+				total.total_latency_ns / tasks / 1e3, total.max_latency_ns / 1e3);
+		fprintf(out, "  execution time: mean %.2f us, max %.2f us\n",
+				total.total_exec_ns / tasks / 1e3, total.max_exec_ns / 1e3);
+		print_histogram(out, "latency", total.latency_histogram);
+		print_histogram(out, "execution", total.exec_histogram);
+		fprintf(out, "  idle: %.3f ms parked, %lu idle spins, steals %lu/%lu attempts\n",
+				total.idle_ns / 1e6, (unsigned long) total.idle_spins,
+				(unsigned long) total.steals, (unsigned long) total.steal_attempts);
+		fprintf(out, "  tasks per worker:");
+		for (uint64_t worker_tasks : total.tasks_per_worker)
+			fprintf(out, " %lu", (unsigned long) worker_tasks);
+		fprintf(out, "\n");
+	}
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef RANGE_BATCH_SCHEDULING_HPP
+#define RANGE_BATCH_SCHEDULING_HPP
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "boundedThreadPool.hpp"
+#include "collatz_reducers.hpp"
+#include "parse_utility.hpp"
+#include "threadPool.hpp"
+#include "thread_team.hpp"
+#include "workStealingThreadPool.hpp"
+
+// All the command-line ranges flattened into one global index space
+// [0, size): global index g maps to ranges[r].first + (g - offsets[r]).
+class RangeBatch {
+    std::vector<std::pair<long, long> > ranges;
+    std::vector<long> offsets;
+    long total_size;
+
+public:
+    explicit RangeBatch(const std::vector<std::pair<long, long> > &ranges);
+
+    long size() const { return total_size; }
+
+    size_t num_ranges() const { return ranges.size(); }
+
+    const std::pair<long, long> &range(size_t r) const { return ranges[r]; }
+
+    // call piece(r, first, last) for every part of the global interval
+    // [global_first, global_last] that falls within range r
+    template<typename Piece>
+    void for_each_piece(long global_first, long global_last, Piece &&piece) const {
+        size_t r = std::upper_bound(offsets.begin(), offsets.end(), global_first) - offsets.begin() - 1;
+        while (global_first <= global_last) {
+            //skip empty ranges
+            while (offsets[r + 1] <= global_first) {
+                r++;
+            }
+            long piece_last = std::min(global_last, offsets[r + 1] - 1);
+            piece(r, ranges[r].first + (global_first - offsets[r]),
+                  ranges[r].first + (piece_last - offsets[r]));
+            global_first = piece_last + 1;
+        }
+    }
+};
+
+// Run every range within a single parallel region: one run of the team
+// covers all ranges (static, dynamic-index or hierarchical policy, the
+// latter with num_groups groups), the results are reduced per range and
+// returned in command-line order
+template<typename Reducer>
+std::vector<typename Reducer::value_type> execute_batched_scheduling(
+    SchedulingPolicy policy, int task_size, ThreadTeam &team,
+    const std::vector<std::pair<long, long> > &ranges, const Reducer &reducer, int num_groups = 1);
+
+// Same for the thread pool policy: the chunks of all ranges are submitted
+// as one batch of tasks with a single wait
+template<typename Reducer>
+std::vector<typename Reducer::value_type> execute_batched_TP_scheduling(
+    int task_size, ThreadPool &tp, const std::vector<std::pair<long, long> > &ranges, const Reducer &reducer);
+
+template<typename Reducer>
+std::vector<typename Reducer::value_type> execute_batched_TP_scheduling(
+    int task_size, WorkStealingThreadPool &tp, const std::vector<std::pair<long, long> > &ranges,
+    const Reducer &reducer);
+
+template<typename Reducer>
+std::vector<typename Reducer::value_type> execute_batched_TP_scheduling(
+    int task_size, BoundedThreadPool &tp, const std::vector<std::pair<long, long> > &ranges,
+    const Reducer &reducer);
+#endif //RANGE_BATCH_SCHEDULING_HPP
@@ -0,0 +1,61 @@
+#ifndef REDUCTION_HPP
+#define REDUCTION_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "cache_aligned.hpp"
+
+// A Reducer describes how chunks of a range are folded into a result:
+//
+//	struct Reducer {
+//		using value_type = ...;
+//		value_type identity() const;
+//		// fold the inclusive chunk [first, last] into acc
+//		void accumulate(value_type &acc, long first, long last) const;
+//		// fold a partial result into acc (associative)
+//		void combine(value_type &acc, const value_type &other) const;
+//	};
+//
+// PerWorkerAccumulator keeps one partial per worker, each on its own cache
+// lines: workers accumulate without any synchronization and the partials
+// are combined once, after the join (result()).
+template <typename Reducer>
+class PerWorkerAccumulator {
+
+public:
+	using value_type = typename Reducer::value_type;
+
+private:
+	Reducer reducer;
+	std::vector<CacheAligned<value_type>> partials;
+
+public:
+	PerWorkerAccumulator(const Reducer & reducer_, std::size_t num_workers) :
+		reducer(reducer_),
+		partials(num_workers, {reducer_.identity()}) {}
+
+	std::size_t size() const {
+		return partials.size();
+	}
+
+	// must be called by the owner of worker_id only
+	value_type & partial(std::size_t worker_id) {
+		return partials[worker_id].value;
+	}
+
+	// must be called by the owner of worker_id only
+	void accumulate(std::size_t worker_id, long first, long last) {
+		reducer.accumulate(partials[worker_id].value, first, last);
+	}
+
+	// single join point: combine the partials of all the workers
+	value_type result() const {
+		value_type result = reducer.identity();
+		for (const auto & partial : partials)
+			reducer.combine(result, partial.value);
+		return result;
+	}
+};
+
+#endif
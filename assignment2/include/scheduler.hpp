@@ -0,0 +1,298 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "cache_aligned.hpp"
+#include "chunk_bounds.hpp"
+#include "reduction.hpp"
+#include "thread_team.hpp"
+#include "trace.hpp"
+
+// Header-only core of the scheduling policies. schedule<Policy> cuts the
+// inclusive range in chunks of chunk elem, Policy hands them out to the
+// workers of the executor (a ThreadTeam or a pool) and every chunk is folded
+// into the partial of the worker running it with body(partial, first, last);
+// the partials are combined with the reducer after the join. Policy, body
+// and reducer are template parameters, so each worker loop is compiled with
+// the body inlined: the only indirect call left is the one starting a worker
+// (team job) or a task (pool).
+//
+// A Policy provides
+//
+//	template<typename Executor, typename ChunkBody>
+//	void for_each_chunk(Executor &executor, const std::pair<long, long> &range, long chunk,
+//	                    ChunkBody &&chunk_body) const;
+//
+// calling chunk_body(worker_id, first, last) for every chunk, with
+// worker_id in [0, executor.size()) owned by one thread at a time.
+
+//hands out the chunks one at a time under a mutex
+class ChunkDispatcher {
+    std::pair<long, long> range;
+    long task_size;
+    long current_index;
+    //set on the last chunk: current_index never moves past range.second,
+    //which can be LONG_MAX
+    bool exhausted;
+    std::mutex _mutex;
+
+public:
+    ChunkDispatcher(std::pair<long, long> range, long task_size)
+        : range(range), task_size(task_size), current_index(range.first), exhausted(range.first > range.second) {}
+
+    //empty (first > last) once the range is over
+    std::pair<long, long> next_chunk() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (exhausted) {
+            return {1, 0};
+        }
+        long start_index_chunk = current_index;
+        long end_index_chunk = chunk_last(current_index, task_size, range.second);
+        exhausted = end_index_chunk == range.second;
+        current_index = exhausted ? end_index_chunk : end_index_chunk + 1;
+        return {start_index_chunk, end_index_chunk};
+    }
+};
+
+// Two-level replacement of the single shared chunk index: the range is cut
+// in num_groups contiguous sub-ranges, each with its own counter on its own
+// cache line, and every thread belongs to one group. Threads claim chunks
+// from their group first, so the counters are only shared within a group;
+// a thread whose group ran dry steals chunks from the other groups.
+class HierarchicalDispatcher {
+    //counters hold chunk indices, not values: they can run past the last
+    //chunk without overflowing when the range ends at LONG_MAX
+    struct Group {
+        std::atomic<long> next;
+        long end;
+    };
+
+    std::unique_ptr<CacheAligned<Group>[]> groups;
+    int group_count;
+    std::pair<long, long> range;
+    long task_size;
+
+public:
+    HierarchicalDispatcher(std::pair<long, long> range, long task_size, int num_groups)
+        : group_count(std::max(1, num_groups)), range(range), task_size(task_size) {
+        groups.reset(new CacheAligned<Group>[group_count]);
+        //sub-ranges are made of whole chunks, split as evenly as possible
+        const long num_chunks = range.first <= range.second ? (range.second - range.first) / task_size + 1 : 0;
+        for (int g = 0; g < group_count; g++) {
+            groups[g].value.next.store(num_chunks * g / group_count, std::memory_order_relaxed);
+            groups[g].value.end = num_chunks * (g + 1) / group_count;
+        }
+    }
+
+    int num_groups() const { return group_count; }
+
+    // group of thread_id when num_threads threads share the dispatcher:
+    // consecutive ids share a group (with -p compact, a socket)
+    int group_of(int thread_id, int num_threads) const {
+        return static_cast<long>(thread_id) * group_count / num_threads;
+    }
+
+    // claim the next chunk, from home_group first and then from the others;
+    // false once the whole range has been handed out
+    bool next_chunk(int home_group, std::pair<long, long> &chunk) {
+        for (int i = 0; i < group_count; i++) {
+            int g = (home_group + i) % group_count;
+            Group &group = groups[g].value;
+            //a plain load keeps drained groups read-only (no line ping-pong)
+            if (group.next.load(std::memory_order_relaxed) >= group.end) {
+                continue;
+            }
+            long c = group.next.fetch_add(1, std::memory_order_relaxed);
+            if (c < group.end) {
+                long first = range.first + c * task_size;
+                chunk = {first, chunk_last(first, task_size, range.second)};
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+//team member thread_id gets chunks thread_id, thread_id + size(), ...
+struct StaticBlockCyclic {
+    template<typename ChunkBody>
+    void for_each_chunk(ThreadTeam &team, const std::pair<long, long> &range, long chunk,
+                        ChunkBody &&chunk_body) const {
+        const int num_threads = team.size();
+        //the team threads are reused across ranges: no thread creation here
+        team.run([&](int thread_id) {
+            //private copy: its captures stay in registers across the chunks
+            auto body = chunk_body;
+            const long stride = num_threads * chunk;
+            const long offset = thread_id * chunk;
+            if (range.first > range.second || range.second - range.first < offset) {
+                return;
+            }
+            //the step past the last chunk is not taken: range.second can be LONG_MAX
+            for (long i = range.first + offset;; i += stride) {
+                body(thread_id, i, chunk_last(i, chunk, range.second));
+                if (range.second - i < stride) {
+                    break;
+                }
+            }
+        });
+    }
+};
+
+//team members claim the chunks from a ChunkDispatcher
+struct DynamicIndex {
+    template<typename ChunkBody>
+    void for_each_chunk(ThreadTeam &team, const std::pair<long, long> &range, long chunk,
+                        ChunkBody &&chunk_body) const {
+        ChunkDispatcher dispatcher(range, chunk);
+        team.run([&](int thread_id) {
+            auto body = chunk_body;
+            for (auto current = dispatcher.next_chunk(); current.first <= current.second;
+                 current = dispatcher.next_chunk()) {
+                body(thread_id, current.first, current.second);
+            }
+        });
+    }
+};
+
+//team members claim the chunks from a HierarchicalDispatcher
+struct HierarchicalIndex {
+    int num_groups;
+
+    template<typename ChunkBody>
+    void for_each_chunk(ThreadTeam &team, const std::pair<long, long> &range, long chunk,
+                        ChunkBody &&chunk_body) const {
+        HierarchicalDispatcher dispatcher(range, chunk, num_groups);
+        team.run([&](int thread_id) {
+            auto body = chunk_body;
+            const int home_group = dispatcher.group_of(thread_id, team.size());
+            std::pair<long, long> current;
+            while (dispatcher.next_chunk(home_group, current)) {
+                body(thread_id, current.first, current.second);
+            }
+        });
+    }
+};
+
+//one pool task per chunk, all submitted up front; the task only captures
+//the body reference and the bounds, so it is stored inline by the pool.
+//With a pool that has priorities, the last high_priority_tail chunks go to
+//its high priority queue and overtake the chunks queued before them
+struct PoolChunkTasks {
+    long high_priority_tail = 0;
+
+    template<typename Pool, typename ChunkBody>
+    void for_each_chunk(Pool &tp, const std::pair<long, long> &range, long chunk, ChunkBody &&chunk_body) const {
+        const long num_chunks = range.first <= range.second ? (range.second - range.first) / chunk + 1 : 0;
+        long c = 0;
+        for (long first = range.first; first <= range.second; first += chunk, c++) {
+            long last = chunk_last(first, chunk, range.second);
+            auto task = [&chunk_body, first, last] {
+                chunk_body(Pool::current_worker(), first, last);
+            };
+            if constexpr (requires { tp.submit_with_priority(Pool::HIGH_PRIORITY, task); }) {
+                if (num_chunks - c <= high_priority_tail) {
+                    tp.submit_with_priority(Pool::HIGH_PRIORITY, task);
+                } else {
+                    tp.submit(task);
+                }
+            } else {
+                tp.submit(task);
+            }
+            if (last == range.second) {
+                break;
+            }
+        }
+        tp.wait_all();
+    }
+};
+
+//size() tasks claiming the chunks from a shared counter (parallel_for):
+//memory stays O(threads)
+struct PoolBulkRange {
+    template<typename Pool, typename ChunkBody>
+    void for_each_chunk(Pool &tp, const std::pair<long, long> &range, long chunk, ChunkBody &&chunk_body) const {
+        tp.parallel_for(range, chunk, chunk_body);
+    }
+};
+
+//tasks per pool thread kept in flight by PoolLazyChunks
+constexpr long LAZY_TASKS_PER_THREAD = 4;
+
+//only LAZY_TASKS_PER_THREAD tasks per thread exist at any time, each one
+//submitting the next unclaimed chunk when done: memory does not depend on
+//the number of chunks and the first chunks start while the others are
+//still to be generated
+struct PoolLazyChunks {
+    //state shared by the tasks: the tasks themselves only carry a pointer
+    //and a chunk index, so they are stored inline by the pool
+    template<typename Pool, typename ChunkBody>
+    struct LazyChunks {
+        Pool &tp;
+        ChunkBody &chunk_body;
+        const std::pair<long, long> &range;
+        long task_size;
+        long num_chunks;
+        std::atomic<long> next_chunk;
+
+        void submit(long chunk) {
+            tp.submit([this, chunk] {
+                long first = range.first + chunk * task_size;
+                long last = chunk_last(first, task_size, range.second);
+                chunk_body(Pool::current_worker(), first, last);
+                //refill: the finished task is replaced by the next unclaimed chunk
+                long next = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (next < num_chunks) {
+                    submit(next);
+                }
+            });
+        }
+    };
+
+    template<typename Pool, typename ChunkBody>
+    void for_each_chunk(Pool &tp, const std::pair<long, long> &range, long chunk, ChunkBody &&chunk_body) const {
+        long num_chunks = range.first <= range.second ? (range.second - range.first) / chunk + 1 : 0;
+        long in_flight = std::min<long>(num_chunks, LAZY_TASKS_PER_THREAD * tp.size());
+        //the refills are submitted by the workers, and a bounded pool blocks
+        //the producer while its ring is full: with at most half of the slots
+        //in flight a refill always finds room and never waits on the workers
+        if constexpr (requires { tp.queue_capacity(); }) {
+            in_flight = std::min<long>(in_flight, std::max<long>(1, tp.queue_capacity() / 2));
+        }
+        LazyChunks<Pool, ChunkBody> chunks{tp, chunk_body, range, chunk, num_chunks, {in_flight}};
+        for (long c = 0; c < in_flight; c++) {
+            chunks.submit(c);
+        }
+        tp.wait_all();
+    }
+};
+
+//fold range with body(partial, first, last) per chunk handed out by policy,
+//partials combined with reducer (identity and combine only)
+template<typename Policy, typename Executor, typename Body, typename Reducer>
+typename Reducer::value_type schedule(Executor &executor, const std::pair<long, long> &range, long chunk,
+                                      Body &&body, const Reducer &reducer, const Policy &policy = Policy()) {
+    //one padded partial per worker: no false sharing, no future
+    PerWorkerAccumulator<Reducer> accumulator(reducer, executor.size());
+    policy.for_each_chunk(executor, range, chunk, [&accumulator, &body](auto worker_id, long first, long last) {
+        TraceSpan traced("chunk", first, last);
+        body(accumulator.partial(worker_id), first, last);
+    });
+    return accumulator.result();
+}
+
+//same, with reducer.accumulate as the body
+template<typename Policy, typename Executor, typename Reducer>
+typename Reducer::value_type schedule(Executor &executor, const std::pair<long, long> &range, long chunk,
+                                      const Reducer &reducer, const Policy &policy = Policy()) {
+    return schedule<Policy>(executor, range, chunk,
+                            [&reducer](typename Reducer::value_type &partial, long first, long last) {
+                                reducer.accumulate(partial, first, last);
+                            },
+                            reducer, policy);
+}
+
+#endif //SCHEDULER_HPP
@@ -0,0 +1,165 @@
+#ifndef SMALL_TASK_HPP
+#define SMALL_TASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Move-only replacement for std::function<void(void)>: callables up to
+// inline_size bytes are stored in place, so building, queueing and running
+// a task does not touch the heap. Bigger callables fall back to new.
+class SmallTask {
+
+public:
+	static constexpr std::size_t inline_size = 48;
+
+private:
+	struct Ops {
+		void (*invoke)(void *storage);
+		void (*move)(void *dst, void *src);
+		void (*destroy)(void *storage);
+	};
+
+	template <typename Fn>
+	static constexpr bool fits_inline =
+		sizeof(Fn) <= inline_size &&
+		alignof(Fn) <= alignof(std::max_align_t) &&
+		std::is_nothrow_move_constructible<Fn>::value;
+
+	template <typename Fn>
+	static const Ops* inline_ops() {
+		static const Ops ops = {
+			[](void *s) { (*static_cast<Fn*>(s))(); },
+			[](void *d, void *s) {
+				new (d) Fn(std::move(*static_cast<Fn*>(s)));
+				static_cast<Fn*>(s)->~Fn();
+			},
+			[](void *s) { static_cast<Fn*>(s)->~Fn(); }
+		};
+		return &ops;
+	}
+
+	template <typename Fn>
+	static const Ops* heap_ops() {
+		static const Ops ops = {
+			[](void *s) { (**static_cast<Fn**>(s))(); },
+			[](void *d, void *s) {
+				*static_cast<Fn**>(d) = *static_cast<Fn**>(s);
+			},
+			[](void *s) { delete *static_cast<Fn**>(s); }
+		};
+		return &ops;
+	}
+
+	alignas(std::max_align_t) unsigned char storage[inline_size];
+	const Ops *ops = nullptr;
+
+public:
+	SmallTask() noexcept = default;
+
+	template <typename Func, typename Fn = typename std::decay<Func>::type,
+			  typename = typename std::enable_if<
+				  !std::is_same<Fn, SmallTask>::value>::type>
+	SmallTask(Func && func) {
+		if constexpr (fits_inline<Fn>) {
+			new (storage) Fn(std::forward<Func>(func));
+			ops = inline_ops<Fn>();
+		} else {
+			*reinterpret_cast<Fn**>(storage) = new Fn(std::forward<Func>(func));
+			ops = heap_ops<Fn>();
+		}
+	}
+
+	SmallTask(SmallTask && other) noexcept : ops(other.ops) {
+		if (ops) {
+			ops->move(storage, other.storage);
+			other.ops = nullptr;
+		}
+	}
+
+	SmallTask& operator=(SmallTask && other) noexcept {
+		if (this != &other) {
+			reset();
+			if (other.ops) {
+				other.ops->move(storage, other.storage);
+				ops = other.ops;
+				other.ops = nullptr;
+			}
+		}
+		return *this;
+	}
+
+	SmallTask(const SmallTask &) = delete;
+	SmallTask& operator=(const SmallTask &) = delete;
+
+	~SmallTask() {
+		reset();
+	}
+
+	void reset() {
+		if (ops) {
+			ops->destroy(storage);
+			ops = nullptr;
+		}
+	}
+
+	void operator()() {
+		ops->invoke(storage);
+	}
+
+	explicit operator bool() const {
+		return ops != nullptr;
+	}
+};
+
+// FIFO (of SmallTask, or of T wrapping one) backed by a power-of-two ring. The ring only grows
+// (doubling) when full and never shrinks, so once it has reached the
+// working-set size push and pop do not allocate.
+template <typename T>
+class RingQueue {
+
+private:
+	std::vector<T> ring;
+	std::size_t head;
+	std::size_t count;
+
+	void grow() {
+		std::vector<T> larger(ring.size() * 2);
+		for (std::size_t i = 0; i < count; i++)
+			larger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+		ring.swap(larger);
+		head = 0;
+	}
+
+public:
+	explicit RingQueue(std::size_t initial_capacity = 1024) :
+		ring(initial_capacity), head(0), count(0) {}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	std::size_t size() const {
+		return count;
+	}
+
+	void push(T && item) {
+		if (count == ring.size())
+			grow();
+		ring[(head + count) & (ring.size() - 1)] = std::move(item);
+		count++;
+	}
+
+	T pop() {
+		T item = std::move(ring[head]);
+		head = (head + 1) & (ring.size() - 1);
+		count--;
+		return item;
+	}
+};
+
+using TaskQueue = RingQueue<SmallTask>;
+
+#endif
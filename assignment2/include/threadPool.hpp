@@ -1,42 +1,143 @@
 #ifndef THREADPOOL_HPP
 #define THREADPOOL_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <future>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <tuple>
+#include <immintrin.h>
+
+#include "chunked_reduce.hpp"
+#include "pool_stats.hpp"
+#include "small_task.hpp"
+#include "thread_affinity.hpp"
+#include "trace.hpp"
 
 class ThreadPool {
 
+public:
+
+	// one FIFO queue per level, HIGH_PRIORITY is served first
+	enum Priority : uint32_t {
+		HIGH_PRIORITY,
+		NORMAL_PRIORITY,
+		LOW_PRIORITY,
+		PRIORITY_LEVELS
+	};
+
+	// time spent in the queue by the tasks of one priority level
+	// (only recorded after track_queue_wait(true))
+	struct QueueWaitStats {
+		uint64_t tasks;
+		double total_wait_us;
+		double max_wait_us;
+	};
+
 private:
 
+	using clock = std::chrono::steady_clock;
+
+	struct QueuedTask {
+		SmallTask task;
+		clock::time_point enqueued;
+	};
+
 	// storage for threads and tasks
 	std::vector<std::thread> threads;
-	// the queue can store any callable object of type void(void)
-	std::queue<std::function<void(void)>> tasks;
+	// the queues can store any callable object of type void(void),
+	// small callables are kept inline (no heap allocation)
+	RingQueue<QueuedTask> tasks[PRIORITY_LEVELS];
+	// modified under the lock, also polled without it by idle workers
+	std::atomic<uint64_t> queued_tasks;
+
+	// bounded starvation: a non-empty level is passed over at most
+	// starvation_limit times in a row by higher priority pops
+	const uint32_t starvation_limit;
+	uint32_t bypassed[PRIORITY_LEVELS];
+
+	bool track_wait;
+	QueueWaitStats wait_stats[PRIORITY_LEVELS];
+
+	// per-worker counters, only recorded after enable_stats(true)
+	PoolStats stats;
+	std::atomic<bool> collect_stats;
 
 	// primitives for signaling
 	std::mutex mutex;
 	std::condition_variable cv;
+	// signaled when the pool runs out of work (see wait_all)
+	std::condition_variable idle_cv;
 
 	// the state of the thread pool
 	bool stop_pool;
 	uint32_t active_threads;
+	// workers blocked on cv: producers skip notify_one when there are none
+	uint32_t sleeping_threads;
 	const uint32_t capacity;
 
+	// idle workers poll the queue spin_iterations times (pause), then
+	// yield_iterations times (yield) before blocking on cv
+	const uint32_t spin_iterations;
+	const uint32_t yield_iterations;
+
+	// index of the calling thread within its pool, -1 outside
+	static int& worker_index() {
+		static thread_local int index = -1;
+		return index;
+	}
+
 	// custom task factory
 	template <typename Func, typename ... Args,
-			  typename Rtrn=typename std::result_of<Func(Args...)>::type>
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
 	auto make_task(Func && func, Args && ...args) -> std::packaged_task<Rtrn(void)> {
 
-		auto aux = std::bind(std::forward<Func>(func),
-							 std::forward<Args>(args)...);
+		// capture callable and arguments by value, as std::bind
+		// did, without the extra type-erased copy
+		auto aux = [func = std::forward<Func>(func),
+					args = std::make_tuple(std::forward<Args>(args)...)] ( ) mutable -> Rtrn {
+			return std::apply(func, args);
+		};
 
-		return std::packaged_task<Rtrn(void)>(aux);
+		return std::packaged_task<Rtrn(void)>(std::move(aux));
+	}
+
+	// serve the highest non-empty level, unless a lower non-empty level
+	// has already been passed over starvation_limit times (must be called
+	// with the lock held and some task queued)
+	QueuedTask pop_task() {
+		uint32_t chosen = 0;
+		while (tasks[chosen].empty())
+			chosen++;
+		for (uint32_t level = PRIORITY_LEVELS - 1; level > chosen; level--) {
+			if (!tasks[level].empty() && bypassed[level] >= starvation_limit) {
+				chosen = level;
+				break;
+			}
+		}
+		for (uint32_t level = chosen + 1; level < PRIORITY_LEVELS; level++)
+			if (!tasks[level].empty())
+				bypassed[level]++;
+		bypassed[chosen] = 0;
+
+		QueuedTask queued = tasks[chosen].pop();
+		queued_tasks--;
+		// tasks queued before tracking was enabled carry no timestamp
+		if (track_wait && queued.enqueued != clock::time_point()) {
+			double wait_us = std::chrono::duration<double, std::micro>(
+				clock::now() - queued.enqueued).count();
+			QueueWaitStats & stats = wait_stats[chosen];
+			stats.tasks++;
+			stats.total_wait_us += wait_us;
+			stats.max_wait_us = std::max(stats.max_wait_us, wait_us);
+		}
+		return queued;
 	}
 
 	// will be executed before execution of a task
@@ -47,22 +148,99 @@ private:
 	// will be executed after execution of a task
 	void after_task_hook() {
 		active_threads--;
+		if (active_threads == 0 && queued_tasks == 0)
+			idle_cv.notify_all();
+	}
+
+	// append a task to the queue of its priority and wake-up one thread
+	void push_task(SmallTask && task, Priority priority = NORMAL_PRIORITY) {
+		bool wake_up;
+		{
+			// lock the scope
+			std::lock_guard<std::mutex>	lock_guard(mutex);
+
+			// you cannot reuse pool after being stopped
+			if(stop_pool)
+				throw std::runtime_error("enqueue on stopped ThreadPool");
+
+			bool stamp = track_wait || collect_stats.load(std::memory_order_relaxed);
+			tasks[priority].push({std::move(task), stamp ? clock::now() : clock::time_point()});
+			queued_tasks++;
+			if (stamp)
+				stats.record_queue_depth(queued_tasks);
+			wake_up = sleeping_threads > 0;
+		}
+
+		// tell one thread to wake-up, if any is blocked: spinning
+		// workers see the new task by themselves
+		if (wake_up)
+			cv.notify_one();
+	}
+
+	static void cpu_relax() {
+		_mm_pause();
+	}
+
+	// poll the queue without the lock before blocking: a task submitted
+	// shortly after is picked up without a sleep/wake-up round trip
+	void spin_then_yield(uint64_t id) {
+		for (uint32_t spins = 0; spins < spin_iterations; spins++) {
+			if (queued_tasks.load(std::memory_order_relaxed) > 0)
+				return;
+			cpu_relax();
+		}
+		for (uint32_t yields = 0; yields < yield_iterations; yields++) {
+			if (queued_tasks.load(std::memory_order_relaxed) > 0)
+				return;
+			if (collect_stats.load(std::memory_order_relaxed))
+				stats.record_idle_spin(id);
+			std::this_thread::yield();
+		}
 	}
 
 public:
-	ThreadPool(uint64_t capacity_) :
+	static constexpr uint32_t DEFAULT_STARVATION_LIMIT = 16;
+	static constexpr uint32_t DEFAULT_SPIN_ITERATIONS = 1 << 12;
+	static constexpr uint32_t DEFAULT_YIELD_ITERATIONS = 16;
+
+	// with more workers than hardware threads polling only steals the core
+	// from a thread that has work, so idle workers block right away (see
+	// ThreadTeam); spin_iterations = yield_iterations = 0 does the same
+	ThreadPool(uint64_t capacity_, uint32_t starvation_limit_ = DEFAULT_STARVATION_LIMIT,
+			   uint32_t spin_iterations_ = DEFAULT_SPIN_ITERATIONS,
+			   uint32_t yield_iterations_ = DEFAULT_YIELD_ITERATIONS) :
+		queued_tasks(0),
+		starvation_limit(starvation_limit_),
+		bypassed(),
+		track_wait(false),
+		wait_stats(),
+		stats(capacity_),
+		collect_stats(false),
 		stop_pool(false), // pool is running
 		active_threads(0), // no work to be done
-		capacity(capacity_) { // remember size
+		sleeping_threads(0),
+		capacity(capacity_), // remember size
+		spin_iterations(capacity_ > std::thread::hardware_concurrency() ? 0 : spin_iterations_),
+		yield_iterations(capacity_ > std::thread::hardware_concurrency() ? 0 : yield_iterations_) {
 
 		// this function is executed by the threads
-		auto wait_loop = [this] ( ) -> void {
+		auto wait_loop = [this] (uint64_t id) -> void {
+
+			worker_index() = id;
 
 			// wait forever
 			while (true) {
 
 				// this is a placeholder task
-				std::function<void(void)> task;
+				QueuedTask queued;
+
+				// from finding the queue empty to getting a task
+				int64_t idle_start = -1;
+				if (queued_tasks.load(std::memory_order_relaxed) == 0) {
+					if (trace_enabled.load(std::memory_order_relaxed))
+						idle_start = trace_now_ns();
+					spin_then_yield(id);
+				}
 
 				{
 					// lock this section for waiting
@@ -74,26 +252,53 @@ public:
 					// has been stopped, or (ii) there
 					// are still tasks to be processed
 					auto predicate = [this] ( ) -> bool {
-						return (stop_pool) || !(tasks.empty());
+						return (stop_pool) || queued_tasks > 0;
 					};
 
 					// wait to be waken up on
 					// aforementioned conditions
-					cv.wait(unique_lock, predicate);
+					if (!predicate()) {
+						sleeping_threads++;
+						if (collect_stats.load(std::memory_order_relaxed)) {
+							clock::time_point parked = clock::now();
+							cv.wait(unique_lock, predicate);
+							stats.record_idle(id, parked, clock::now());
+						} else {
+							cv.wait(unique_lock, predicate);
+						}
+						sleeping_threads--;
+					}
 
 					// exit if thread pool stopped
 					// and no tasks to be performed
-					if (stop_pool && tasks.empty())
+					if (stop_pool && queued_tasks == 0) {
+						if (idle_start >= 0)
+							trace_record("idle", idle_start, trace_now_ns());
 						return;
+					}
 
 					// else extract task from queue
-					task = std::move(tasks.front());
-					tasks.pop();
+					queued = pop_task();
 					before_task_hook();
 				} // here we release the lock
-
-				// execute the task in parallel
-				task();
+				if (idle_start >= 0)
+					trace_record("idle", idle_start, trace_now_ns());
+
+				// execute the task in parallel and destroy it
+				// before reporting completion
+				const int64_t task_start = trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : -1;
+				if (queued.enqueued != clock::time_point() &&
+					collect_stats.load(std::memory_order_relaxed)) {
+					clock::time_point started = clock::now();
+					queued.task();
+					queued.task.reset();
+					stats.record_task(id, queued.enqueued, started, clock::now());
+				} else {
+					queued.task();
+					queued.task.reset();
+				}
+				if (task_start >= 0)
+					trace_record("task", task_start, trace_now_ns());
 
 				{
 					// adjust the thread counter
@@ -105,7 +310,7 @@ public:
 
 		// initially spawn capacity many threads
 		for (uint64_t id = 0; id < capacity; id++)
-			threads.emplace_back(wait_loop);
+			threads.emplace_back(wait_loop, id);
 	}
 
 	~ThreadPool() {
@@ -124,46 +329,124 @@ public:
 		// finally join all threads
 		for (auto& thread : threads)
 			thread.join();
+
+		if (collect_stats.load())
+			stats.print(stdout, "ThreadPool");
 	}
 	
 	template <typename Func, typename ... Args,
-			  typename Rtrn=typename std::result_of<Func(Args...)>::type>
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
 	auto enqueue(Func && func, Args && ... args) -> std::future<Rtrn> {
 
-		// create the task, get the future
-		// and wrap task in a shared pointer
-		auto task = make_task(func, args...);
+		// create the task and get the future: the packaged_task
+		// is move-only and small, so it is queued directly (the
+		// only allocation left is the shared state of the future)
+		auto task = make_task(std::forward<Func>(func), std::forward<Args>(args)...);
 		auto future = task.get_future();
 
-		// create an object on the heap and returns a std::shared_ptr
-		// the allocated object will be automatically deleted  when
-		// there are no more references to it
-		// LR: reference counting di Rust
-		auto task_ptr = std::make_shared<decltype(task)>(std::move(task));
-		{
-			// lock the scope
-			std::lock_guard<std::mutex>	lock_guard(mutex);
+		push_task(SmallTask(std::move(task)));
 
-			// you cannot reuse pool after being stopped
-			if(stop_pool)
-				throw std::runtime_error("enqueue on stopped ThreadPool");
+		return future;
+	}
 
-			// wrap the task in a generic void
-			// function void -> void
-			auto payload = [task_ptr] ( ) -> void {
-				// basically call task()
-				task_ptr->operator()();
-			};
+	// fire-and-forget submission: no future is created, results must be
+	// written by the task itself (e.g. into a caller-supplied slot) and
+	// collected after wait_all(). Small callables never allocate.
+	template <typename Func>
+	void submit(Func && func) {
+		push_task(SmallTask(std::forward<Func>(func)));
+	}
 
-			// append the task to the queue
-			tasks.emplace(payload);
-		}
+	// same as enqueue/submit, into the queue of the given priority
+	template <typename Func, typename ... Args,
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
+	auto enqueue_with_priority(Priority priority, Func && func, Args && ... args) -> std::future<Rtrn> {
+		auto task = make_task(std::forward<Func>(func), std::forward<Args>(args)...);
+		auto future = task.get_future();
 
-		// tell one thread to wake-up
-		cv.notify_one();
+		push_task(SmallTask(std::move(task)), priority);
 
 		return future;
 	}
+
+	template <typename Func>
+	void submit_with_priority(Priority priority, Func && func) {
+		push_task(SmallTask(std::forward<Func>(func)), priority);
+	}
+
+	// record the queue wait time of the tasks submitted from now on
+	void track_queue_wait(bool enable) {
+		std::lock_guard<std::mutex> lock_guard(mutex);
+		track_wait = enable;
+	}
+
+	QueueWaitStats queue_wait_stats(Priority priority) {
+		std::lock_guard<std::mutex> lock_guard(mutex);
+		return wait_stats[priority];
+	}
+
+	// collect per-worker latency/execution histograms, idle time and the
+	// maximum queue depth for the tasks submitted from now on; when enabled
+	// the summary is also printed at destruction
+	void enable_stats(bool enable) {
+		collect_stats.store(enable);
+	}
+
+	// merge the per-worker counters (can be called while running)
+	PoolStats::Summary stats_summary() const {
+		return stats.summary();
+	}
+
+	void print_stats(FILE * out = stdout) const {
+		stats.print(out, "ThreadPool");
+	}
+
+	// block until the queue is empty and no task is running
+	void wait_all() {
+		std::unique_lock<std::mutex> unique_lock(mutex);
+		idle_cv.wait(unique_lock, [this] ( ) -> bool {
+			return queued_tasks == 0 && active_threads == 0;
+		});
+	}
+
+	uint32_t size() const {
+		return capacity;
+	}
+
+	// index of the calling worker in [0, size()), -1 outside the pool
+	static int current_worker() {
+		return worker_index();
+	}
+
+	// pin worker id to cpu_map[id % cpu_map.size()], false if
+	// some cpu could not be used
+	bool pin_workers(const std::vector<int> & cpu_map) {
+		bool pinned = true;
+		for (size_t id = 0; id < threads.size() && !cpu_map.empty(); id++)
+			pinned &= pin_thread(threads[id].native_handle(), cpu_map[id % cpu_map.size()]);
+		return pinned;
+	}
+
+	// run body(worker_id, first, last) over the inclusive range split in
+	// chunks of chunk elements: worker_id in [0, size()) is owned by one
+	// task at a time, so it can index per-worker accumulators
+	template <typename Body>
+	void parallel_for(const std::pair<long, long> &range, long chunk, Body && body) {
+		chunked_parallel_for(*this, range, chunk, std::forward<Body>(body));
+	}
+
+	// run body(first, last) over the inclusive range split in chunks of
+	// chunk elements and combine the results with reducer: workers claim
+	// chunks from a shared counter and fold them into per-worker slots,
+	// so no per-chunk task nor future is created
+	template <typename Body, typename Reducer,
+			  typename Rtrn=std::invoke_result_t<Body, long, long>>
+	Rtrn parallel_for_reduce(const std::pair<long, long> &range, long chunk,
+							 Body && body, Reducer && reducer, Rtrn identity = Rtrn()) {
+		return chunked_parallel_for_reduce(*this, range, chunk,
+										   std::forward<Body>(body),
+										   std::forward<Reducer>(reducer), identity);
+	}
 };
 
 #endif
@@ -0,0 +1,38 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+#include <pthread.h>
+#include <vector>
+
+//placement of the worker threads on the cpus (-p)
+enum ThreadPinning {
+    NO_PINNING,         //let the OS scheduler migrate threads
+    COMPACT_PINNING,    //fill a core (SMT siblings), a socket, then the next one
+    SCATTER_PINNING,    //round-robin over NUMA nodes/sockets, then cores, SMT last
+    LIST_PINNING        //explicit cpu list given on the command line
+};
+
+struct CpuTopology {
+    int cpu;
+    int node;       //NUMA node (0 when the kernel exposes none)
+    int package;    //physical socket
+    int core;       //core id within the package
+};
+
+//topology of the cpus the process is allowed to run on, by cpu number
+std::vector<CpuTopology> available_cpus();
+
+//cpu of every thread: thread i is pinned to cpu_map[i % cpu_map.size()];
+//empty when pinning is disabled
+std::vector<int> build_cpu_map(ThreadPinning pinning, const std::vector<int> &cpu_list);
+
+//print "thread i -> cpu c (node, package, core)" for num_threads threads
+void print_cpu_map(const std::vector<int> &cpu_map, int num_threads);
+
+//restrict thread to a single cpu, false if the cpu is not usable
+inline bool pin_thread(pthread_t thread, int cpu) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpu_set) == 0;
+}
+#endif //THREAD_AFFINITY_HPP
@@ -0,0 +1,173 @@
+#ifndef THREAD_TEAM_HPP
+#define THREAD_TEAM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <immintrin.h>
+
+#include "cache_aligned.hpp"
+#include "thread_affinity.hpp"
+#include "trace.hpp"
+
+// Fixed team of threads reused across parallel regions (fork/join without
+// thread creation). The calling thread is member 0 and num_threads - 1
+// helpers are spawned once. Between regions the helpers spin for a bounded
+// number of iterations, then park on a condition variable; the same
+// spin-then-park scheme is used by the caller at the final barrier.
+// With more members than hardware threads spinning only steals the core
+// from a member that has work, so the team parks right away.
+class ThreadTeam {
+
+private:
+
+	std::vector<std::thread> threads;
+	const int num_threads;
+	const uint32_t spin_iterations;
+
+	// current job: type-erased pointer to the callable + trampoline,
+	// nothing is allocated per region
+	void *job_object;
+	void (*job_function)(void *, int);
+
+	// bumped by run() to start a region
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> generation;
+	// helpers still working on the current region
+	alignas(CACHE_LINE_SIZE) std::atomic<int> remaining;
+	std::atomic<int> parked_helpers;
+	std::atomic<bool> caller_parked;
+	bool stop_team;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+
+	static void cpu_relax() {
+		_mm_pause();
+	}
+
+	void helper_loop(int thread_id) {
+		uint64_t seen_generation = 0;
+		// end of the previous job, -1 when not tracing
+		int64_t idle_start = -1;
+		while (true) {
+			// spin first: a region usually follows shortly
+			uint32_t spins = 0;
+			while (generation.load(std::memory_order_acquire) == seen_generation &&
+				   spins < spin_iterations) {
+				cpu_relax();
+				spins++;
+			}
+			if (generation.load(std::memory_order_acquire) == seen_generation) {
+				std::unique_lock<std::mutex> unique_lock(mutex);
+				parked_helpers.fetch_add(1);
+				start_cv.wait(unique_lock, [&] ( ) -> bool {
+					return stop_team || generation.load() != seen_generation;
+				});
+				parked_helpers.fetch_sub(1);
+				if (stop_team) {
+					if (idle_start >= 0)
+						trace_record("idle", idle_start, trace_now_ns());
+					return;
+				}
+			}
+			seen_generation = generation.load(std::memory_order_acquire);
+			if (idle_start >= 0)
+				trace_record("idle", idle_start, trace_now_ns());
+
+			job_function(job_object, thread_id);
+			idle_start = trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : -1;
+
+			// last helper out wakes the caller if it is parked
+			if (remaining.fetch_sub(1) == 1 && caller_parked.load()) {
+				std::lock_guard<std::mutex> lock_guard(mutex);
+				done_cv.notify_one();
+			}
+		}
+	}
+
+public:
+	static constexpr uint32_t DEFAULT_SPIN_ITERATIONS = 1 << 12;
+
+	explicit ThreadTeam(int num_threads_, uint32_t spin_iterations_ = DEFAULT_SPIN_ITERATIONS) :
+		num_threads(num_threads_ > 0 ? num_threads_ : 1),
+		spin_iterations((unsigned) num_threads > std::thread::hardware_concurrency() ? 0 : spin_iterations_),
+		job_object(nullptr),
+		job_function(nullptr),
+		generation(0),
+		remaining(0),
+		parked_helpers(0),
+		caller_parked(false),
+		stop_team(false) {
+
+		for (int thread_id = 1; thread_id < num_threads; thread_id++)
+			threads.emplace_back(&ThreadTeam::helper_loop, this, thread_id);
+	}
+
+	~ThreadTeam() {
+		{
+			std::lock_guard<std::mutex> lock_guard(mutex);
+			stop_team = true;
+		}
+		start_cv.notify_all();
+		for (auto &thread : threads)
+			thread.join();
+	}
+
+	int size() const {
+		return num_threads;
+	}
+
+	// pin member id to cpu_map[id % cpu_map.size()]: member 0 is the
+	// calling thread, which stays pinned after the team is gone
+	bool pin_members(const std::vector<int> & cpu_map) {
+		if (cpu_map.empty())
+			return true;
+		bool pinned = pin_thread(pthread_self(), cpu_map[0]);
+		for (size_t id = 1; id <= threads.size(); id++)
+			pinned &= pin_thread(threads[id - 1].native_handle(), cpu_map[id % cpu_map.size()]);
+		return pinned;
+	}
+
+	// run job(thread_id) on every member of the team, thread_id in
+	// [0, size()), and return once all of them are done
+	template <typename Job>
+	void run(Job &&job) {
+		job_object = &job;
+		job_function = [] (void *object, int thread_id) -> void {
+			(*static_cast<typename std::remove_reference<Job>::type *>(object))(thread_id);
+		};
+		remaining.store(num_threads - 1, std::memory_order_relaxed);
+
+		// publish the job, wake-up parked helpers only if any
+		generation.fetch_add(1);
+		if (parked_helpers.load() > 0) {
+			{ std::lock_guard<std::mutex> lock_guard(mutex); }
+			start_cv.notify_all();
+		}
+
+		job(0);
+
+		// barrier: spin, then park until the last helper is done
+		TraceSpan idle("idle");
+		uint32_t spins = 0;
+		while (remaining.load(std::memory_order_acquire) > 0 && spins < spin_iterations) {
+			cpu_relax();
+			spins++;
+		}
+		if (remaining.load(std::memory_order_acquire) > 0) {
+			std::unique_lock<std::mutex> unique_lock(mutex);
+			caller_parked.store(true);
+			done_cv.wait(unique_lock, [this] ( ) -> bool {
+				return remaining.load() == 0;
+			});
+			caller_parked.store(false);
+		}
+	}
+};
+
+#endif
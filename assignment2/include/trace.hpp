@@ -0,0 +1,139 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Opt-in execution timeline (--trace FILE). Every thread appends its spans
+// (chunks, pool tasks, idle time) to its own buffer: the buffer is
+// registered once per thread under a lock, then recording is a plain
+// push_back by its only writer. Buffers outlive their threads and are
+// written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) at exit,
+// when the teams and the pools are gone.
+
+struct TraceEvent {
+	const char *name;	// string literal: "chunk", "task", "idle"
+	long first;			// chunk bounds, first > last when there are none
+	long last;
+	int64_t start_ns;
+	int64_t end_ns;
+};
+
+struct TraceBuffer {
+	int tid;
+	std::vector<TraceEvent> events;
+	long dropped = 0;
+};
+
+// events kept per thread, the later ones are only counted
+constexpr size_t TRACE_BUFFER_EVENTS = 1 << 20;
+
+inline std::atomic<bool> trace_enabled(false);
+inline std::string trace_path;
+
+inline int64_t trace_now_ns() {
+	static const auto origin = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+struct TraceRegistry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+inline TraceRegistry &trace_registry() {
+	static TraceRegistry registry;
+	return registry;
+}
+
+inline TraceBuffer &trace_buffer() {
+	thread_local TraceBuffer *buffer = [] ( ) -> TraceBuffer * {
+		TraceRegistry &registry = trace_registry();
+		std::lock_guard<std::mutex> lock_guard(registry.mutex);
+		registry.buffers.emplace_back(new TraceBuffer);
+		registry.buffers.back()->tid = registry.buffers.size() - 1;
+		return registry.buffers.back().get();
+	}();
+	return *buffer;
+}
+
+// span [start_ns, end_ns) of the calling thread
+inline void trace_record(const char *name, int64_t start_ns, int64_t end_ns, long first = 1, long last = 0) {
+	TraceBuffer &buffer = trace_buffer();
+	if (buffer.events.size() < TRACE_BUFFER_EVENTS)
+		buffer.events.push_back({name, first, last, start_ns, end_ns});
+	else
+		buffer.dropped++;
+}
+
+// complete ("X") events in microseconds, one thread_name entry per buffer
+inline bool trace_dump(const std::string &path) {
+	FILE *out = fopen(path.c_str(), "w");
+	if (out == nullptr) {
+		fprintf(stderr, "cannot write the trace %s\n", path.c_str());
+		return false;
+	}
+	TraceRegistry &registry = trace_registry();
+	std::lock_guard<std::mutex> lock_guard(registry.mutex);
+	long dropped = 0;
+	const char *separator = "";
+	fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	for (const auto &buffer : registry.buffers) {
+		fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+				"\"args\": {\"name\": \"thread %d\"}}", separator, buffer->tid, buffer->tid);
+		separator = ",\n";
+		for (const TraceEvent &event : buffer->events) {
+			fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+					event.name, buffer->tid, event.start_ns / 1e3, (event.end_ns - event.start_ns) / 1e3);
+			if (event.first <= event.last)
+				fprintf(out, ", \"args\": {\"first\": %ld, \"last\": %ld}", event.first, event.last);
+			fprintf(out, "}");
+		}
+		dropped += buffer->dropped;
+	}
+	fprintf(out, "\n]}\n");
+	fclose(out);
+	if (dropped > 0)
+		fprintf(stderr, "warning: %ld trace events dropped (full buffers)\n", dropped);
+	return true;
+}
+
+// start recording, the trace is written to path at exit
+inline void trace_enable(const std::string &path) {
+	trace_path = path;
+	trace_now_ns();
+	trace_registry();
+	trace_enabled.store(true);
+	atexit([] ( ) -> void {
+		trace_dump(trace_path);
+	});
+}
+
+// records [construction, destruction) as a span of the calling thread
+class TraceSpan {
+	const char *name;
+	long first;
+	long last;
+	int64_t start_ns;
+
+public:
+	explicit TraceSpan(const char *name_, long first_ = 1, long last_ = 0) :
+		name(name_),
+		first(first_),
+		last(last_),
+		start_ns(trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : -1) {}
+
+	~TraceSpan() {
+		if (start_ns >= 0)
+			trace_record(name, start_ns, trace_now_ns(), first, last);
+	}
+};
+
+#endif
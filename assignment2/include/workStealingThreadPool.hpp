@@ -0,0 +1,455 @@
+#ifndef WORK_STEALING_THREADPOOL_HPP
+#define WORK_STEALING_THREADPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <tuple>
+
+#include "chunked_reduce.hpp"
+#include "pool_stats.hpp"
+#include "small_task.hpp"
+#include "thread_affinity.hpp"
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP'13). Only the owner
+// calls push/pop (bottom end), any thread may call steal (top end).
+// Items are raw pointers so that a thief can read a slot before
+// winning the CAS on top without racing on a non-trivial object.
+template <typename T>
+class WorkStealingDeque {
+
+private:
+
+	struct CircularArray {
+		const int64_t size;
+		std::unique_ptr<std::atomic<T*>[]> items;
+
+		explicit CircularArray(int64_t size_) :
+			size(size_), items(new std::atomic<T*>[size_]) {}
+
+		T* get(int64_t index) {
+			return items[index & (size - 1)].load(std::memory_order_relaxed);
+		}
+
+		void put(int64_t index, T* item) {
+			items[index & (size - 1)].store(item, std::memory_order_relaxed);
+		}
+	};
+
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::atomic<CircularArray*> array;
+	// arrays replaced by a grow are kept alive until destruction
+	// since a thief may still be reading from them
+	std::vector<std::unique_ptr<CircularArray>> arrays;
+
+	CircularArray* grow(CircularArray* old_array, int64_t b, int64_t t) {
+		arrays.emplace_back(new CircularArray(old_array->size * 2));
+		CircularArray* new_array = arrays.back().get();
+		for (int64_t i = t; i < b; i++)
+			new_array->put(i, old_array->get(i));
+		array.store(new_array, std::memory_order_release);
+		return new_array;
+	}
+
+public:
+	explicit WorkStealingDeque(int64_t initial_size = 1024) :
+		top(0), bottom(0) {
+		arrays.emplace_back(new CircularArray(initial_size));
+		array.store(arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	// owner only: push an item on the bottom end
+	void push(T* item) {
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		CircularArray* a = array.load(std::memory_order_relaxed);
+		if (b - t > a->size - 1)
+			a = grow(a, b, t);
+		a->put(b, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	// owner only: pop an item from the bottom end (LIFO)
+	T* pop() {
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		CircularArray* a = array.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		T* item = nullptr;
+		if (t <= b) {
+			item = a->get(b);
+			if (t == b) {
+				// last item: race against thieves
+				if (!top.compare_exchange_strong(t, t + 1,
+						std::memory_order_seq_cst, std::memory_order_relaxed))
+					item = nullptr;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// any thread: steal an item from the top end (FIFO)
+	T* steal() {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		CircularArray* a = array.load(std::memory_order_acquire);
+		T* item = a->get(t);
+		if (!top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+};
+
+class WorkStealingThreadPool {
+
+private:
+
+	using clock = PoolStats::clock;
+
+	// enqueued is only stamped while stats are collected
+	struct Task {
+		SmallTask work;
+		clock::time_point enqueued;
+	};
+
+	// every worker owns a deque and an inbox: the deque is filled
+	// by the owner only (tasks spawned from inside a worker), the
+	// inbox receives tasks from external threads, round-robin
+	struct alignas(64) Worker {
+		WorkStealingDeque<Task> deque;
+		std::mutex inbox_mutex;
+		std::vector<Task*> inbox;
+	};
+
+	// storage for threads and per-worker queues
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	// primitives for signaling idle workers
+	std::mutex mutex;
+	std::condition_variable cv;
+	// signaled when the last outstanding task completes (see wait_all)
+	std::condition_variable idle_cv;
+
+	// the state of the thread pool
+	std::atomic<bool> stop_pool;
+	// tasks enqueued but not yet extracted by any worker
+	std::atomic<int64_t> pending_tasks;
+	// tasks enqueued and not yet completed
+	std::atomic<int64_t> outstanding_tasks;
+	std::atomic<uint32_t> sleeping_threads;
+	std::atomic<uint64_t> next_inbox;
+	const uint32_t capacity;
+
+	// per-worker counters, only recorded after enable_stats(true)
+	PoolStats stats;
+	std::atomic<bool> collect_stats;
+
+	// index of the calling thread within its pool, -1 outside
+	static int& worker_index() {
+		static thread_local int index = -1;
+		return index;
+	}
+
+	static WorkStealingThreadPool*& worker_pool() {
+		static thread_local WorkStealingThreadPool* pool = nullptr;
+		return pool;
+	}
+
+	// custom task factory
+	template <typename Func, typename ... Args,
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
+	auto make_task(Func && func, Args && ...args) -> std::packaged_task<Rtrn(void)> {
+
+		auto aux = [func = std::forward<Func>(func),
+					args = std::make_tuple(std::forward<Args>(args)...)] ( ) mutable -> Rtrn {
+			return std::apply(func, args);
+		};
+
+		return std::packaged_task<Rtrn(void)>(std::move(aux));
+	}
+
+	// publish a task: on the own deque when called from a worker,
+	// otherwise on the inbox of a worker chosen round-robin
+	void push_task(Task* payload) {
+		// you cannot reuse pool after being stopped
+		if (stop_pool.load()) {
+			delete payload;
+			throw std::runtime_error("enqueue on stopped WorkStealingThreadPool");
+		}
+
+		// count the task before publishing it, so that a worker
+		// extracting it never observes a negative counter
+		outstanding_tasks.fetch_add(1);
+		int64_t depth = pending_tasks.fetch_add(1) + 1;
+		if (payload->enqueued != clock::time_point())
+			stats.record_queue_depth(depth);
+		if (worker_pool() == this) {
+			workers[worker_index()]->deque.push(payload);
+		} else {
+			Worker& target = *workers[next_inbox.fetch_add(1) % capacity];
+			std::lock_guard<std::mutex> lock_guard(target.inbox_mutex);
+			target.inbox.push_back(payload);
+		}
+
+		// wake-up a worker only if someone is parked
+		if (sleeping_threads.load() > 0) {
+			{ std::lock_guard<std::mutex> lock_guard(mutex); }
+			cv.notify_one();
+		}
+	}
+
+	// move the content of the inbox of a worker into the caller deque,
+	// returning one of the tasks to be executed immediately
+	Task* drain_inbox(Worker& victim, Worker& self, bool blocking) {
+		std::vector<Task*> batch;
+		{
+			std::unique_lock<std::mutex> lock(victim.inbox_mutex, std::defer_lock);
+			if (blocking)
+				lock.lock();
+			else if (!lock.try_lock())
+				return nullptr;
+			if (victim.inbox.empty())
+				return nullptr;
+			batch.swap(victim.inbox);
+		}
+		Task* task = batch.back();
+		batch.pop_back();
+		for (Task* other : batch)
+			self.deque.push(other);
+		return task;
+	}
+
+	Task* find_task(uint32_t id, uint64_t& rng_state) {
+		Worker& self = *workers[id];
+
+		// first look at local work
+		if (Task* task = self.deque.pop())
+			return task;
+		if (Task* task = drain_inbox(self, self, true))
+			return task;
+
+		// then try random victims (xorshift64)
+		for (uint32_t attempt = 0; attempt < 2 * capacity; attempt++) {
+			rng_state ^= rng_state << 13;
+			rng_state ^= rng_state >> 7;
+			rng_state ^= rng_state << 17;
+			uint32_t victim = rng_state % capacity;
+			if (victim == id)
+				continue;
+			Task* task = workers[victim]->deque.steal();
+			// a busy owner cannot drain its inbox: help it
+			if (task == nullptr)
+				task = drain_inbox(*workers[victim], self, false);
+			if (collect_stats.load(std::memory_order_relaxed))
+				stats.record_steal_attempt(id, task != nullptr);
+			if (task != nullptr)
+				return task;
+		}
+		return nullptr;
+	}
+
+	// stamp the task when stats are collected
+	Task* make_payload(SmallTask && work) {
+		return new Task{std::move(work),
+						collect_stats.load(std::memory_order_relaxed) ? clock::now() : clock::time_point()};
+	}
+
+	void wait_loop(uint32_t id) {
+		worker_index() = id;
+		worker_pool() = this;
+		uint64_t rng_state = 0x9E3779B97F4A7C15ull * (id + 1);
+
+		while (true) {
+			Task* task = find_task(id, rng_state);
+
+			if (task != nullptr) {
+				pending_tasks.fetch_sub(1);
+				if (task->enqueued != clock::time_point() &&
+					collect_stats.load(std::memory_order_relaxed)) {
+					clock::time_point enqueued = task->enqueued;
+					clock::time_point started = clock::now();
+					task->work();
+					delete task;
+					stats.record_task(id, enqueued, started, clock::now());
+				} else {
+					task->work();
+					delete task;
+				}
+				if (outstanding_tasks.fetch_sub(1) == 1) {
+					{ std::lock_guard<std::mutex> lock_guard(mutex); }
+					idle_cv.notify_all();
+				}
+				continue;
+			}
+
+			// tasks exist but are being published or sit in a locked
+			// inbox: give up the core instead of spinning on it
+			if (pending_tasks.load() > 0 && !stop_pool.load()) {
+				if (collect_stats.load(std::memory_order_relaxed))
+					stats.record_idle_spin(id);
+				std::this_thread::yield();
+				continue;
+			}
+
+			// nothing found: park until new tasks are enqueued
+			std::unique_lock<std::mutex> unique_lock(mutex);
+			sleeping_threads.fetch_add(1);
+			auto predicate = [this] ( ) -> bool {
+				return stop_pool.load() || pending_tasks.load() > 0;
+			};
+			if (!predicate() && collect_stats.load(std::memory_order_relaxed)) {
+				clock::time_point parked = clock::now();
+				cv.wait(unique_lock, predicate);
+				stats.record_idle(id, parked, clock::now());
+			} else {
+				cv.wait(unique_lock, predicate);
+			}
+			sleeping_threads.fetch_sub(1);
+
+			// exit if thread pool stopped
+			// and no tasks to be performed
+			if (stop_pool.load() && pending_tasks.load() == 0)
+				return;
+		}
+	}
+
+public:
+	WorkStealingThreadPool(uint64_t capacity_) :
+		stop_pool(false), // pool is running
+		pending_tasks(0), // no work to be done
+		outstanding_tasks(0),
+		sleeping_threads(0),
+		next_inbox(0),
+		capacity(capacity_), // remember size
+		stats(capacity_),
+		collect_stats(false) {
+
+		for (uint64_t id = 0; id < capacity; id++)
+			workers.emplace_back(new Worker());
+
+		// initially spawn capacity many threads
+		for (uint64_t id = 0; id < capacity; id++)
+			threads.emplace_back(&WorkStealingThreadPool::wait_loop, this, id);
+	}
+
+	~WorkStealingThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock_guard(mutex);
+			stop_pool = true;
+		}
+
+		// signal all threads
+		cv.notify_all();
+
+		// finally join all threads
+		for (auto& thread : threads)
+			thread.join();
+
+		if (collect_stats.load())
+			stats.print(stdout, "WorkStealingThreadPool");
+	}
+
+	template <typename Func, typename ... Args,
+			  typename Rtrn=std::invoke_result_t<Func, Args...>>
+	auto enqueue(Func && func, Args && ... args) -> std::future<Rtrn> {
+
+		auto task = make_task(std::forward<Func>(func), std::forward<Args>(args)...);
+		auto future = task.get_future();
+
+		push_task(make_payload(SmallTask(std::move(task))));
+
+		return future;
+	}
+
+	// fire-and-forget submission, see ThreadPool::submit. Deque slots
+	// hold pointers, so here one node per task is still allocated.
+	template <typename Func>
+	void submit(Func && func) {
+		push_task(make_payload(SmallTask(std::forward<Func>(func))));
+	}
+
+	// block until every submitted task has completed
+	void wait_all() {
+		std::unique_lock<std::mutex> unique_lock(mutex);
+		idle_cv.wait(unique_lock, [this] ( ) -> bool {
+			return outstanding_tasks.load() == 0;
+		});
+	}
+
+	uint32_t size() const {
+		return capacity;
+	}
+
+	// collect per-worker latency/execution histograms, steals, idle spins
+	// and parked time, and the maximum number of pending tasks, for the
+	// tasks submitted from now on; when enabled the summary is also printed
+	// at destruction
+	void enable_stats(bool enable) {
+		collect_stats.store(enable);
+	}
+
+	// merge the per-worker counters (can be called while running)
+	PoolStats::Summary stats_summary() const {
+		return stats.summary();
+	}
+
+	void print_stats(FILE * out = stdout) const {
+		stats.print(out, "WorkStealingThreadPool");
+	}
+
+	// index of the calling worker in [0, size()), -1 outside the pool
+	static int current_worker() {
+		return worker_index();
+	}
+
+	// pin worker id to cpu_map[id % cpu_map.size()], false if
+	// some cpu could not be used
+	bool pin_workers(const std::vector<int> & cpu_map) {
+		bool pinned = true;
+		for (size_t id = 0; id < threads.size() && !cpu_map.empty(); id++)
+			pinned &= pin_thread(threads[id].native_handle(), cpu_map[id % cpu_map.size()]);
+		return pinned;
+	}
+
+	// run body(worker_id, first, last) over the inclusive range split in
+	// chunks of chunk elements: worker_id in [0, size()) is owned by one
+	// task at a time, so it can index per-worker accumulators
+	template <typename Body>
+	void parallel_for(const std::pair<long, long> &range, long chunk, Body && body) {
+		chunked_parallel_for(*this, range, chunk, std::forward<Body>(body));
+	}
+
+	// run body(first, last) over the inclusive range split in chunks of
+	// chunk elements and combine the results with reducer: workers claim
+	// chunks from a shared counter and fold them into per-worker slots,
+	// so no per-chunk task nor future is created
+	template <typename Body, typename Reducer,
+			  typename Rtrn=std::invoke_result_t<Body, long, long>>
+	Rtrn parallel_for_reduce(const std::pair<long, long> &range, long chunk,
+							 Body && body, Reducer && reducer, Rtrn identity = Rtrn()) {
+		return chunked_parallel_for_reduce(*this, range, chunk,
+										   std::forward<Body>(body),
+										   std::forward<Reducer>(reducer), identity);
+	}
+};
+
+#endif
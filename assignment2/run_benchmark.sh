@@ -2,8 +2,18 @@
 
 RANGE_VALUES="1-1000 50000000-100000000 1000000000-1100000000"
 out_dir="./out"
-scheduling_policy=("d" "s" "t")
-NUM_RUNS=3
+# "tw" runs the thread pool policy on the work-stealing pool (-t -w)
+# "tb" submits the whole range at once (-t -b, parallel_for_reduce)
+# "g" is the hierarchical dispatcher (per-group counters, -G groups)
+# "tl" keeps 4 chunk tasks per thread in flight, each submitting the next (-t -l)
+# "twf" halves the range recursively, joining coroutines on the work-stealing pool (-t -w -f)
+# "tq1024" runs the thread pool policy on the bounded lock-free queue (-t -q 1024)
+# "ostatic", "odynamic", "oguided" are omp for loops over the chunks (-o kind)
+# "e" is std::transform_reduce(std::execution::par) over the chunks
+scheduling_policy=("d" "s" "t" "tw" "tb" "tl" "twf" "g" "tq1024" "ostatic" "odynamic" "oguided" "e")
+# thread placement (-p): the spread between runs is reported for each one
+pinning=("none" "compact" "scatter")
+NUM_RUNS=5
 CSV_FILE="./out/results.csv"
 
 # Interesting combination: chunk_size,num_threads
@@ -34,32 +44,53 @@ interesting_combinations=(
 
 mkdir -p "$out_dir"
 
+# mean and sample standard deviation of the run times in a csv line
+run_statistics() {
+  echo "$1" | awk -F',' -v runs="$NUM_RUNS" '{
+    sum = 0; sq = 0
+    for (i = NF - runs + 1; i <= NF; i++) { sum += $i; sq += $i * $i }
+    mean = sum / runs
+    var = runs > 1 ? (sq - runs * mean * mean) / (runs - 1) : 0
+    printf "%f,%f", mean, (var > 0 ? sqrt(var) : 0)
+  }'
+}
+
 # Header CSV
-echo "target,policy,chunk_size,num_threads,ranges,run1,run2,run3" > "$CSV_FILE"
+header="target,policy,chunk_size,num_threads,pinning,ranges"
+for ((i = 1; i <= NUM_RUNS; i++)); do
+  header="$header,run$i"
+done
+echo "$header,mean,stddev" > "$CSV_FILE"
 
 # Loop su policy, e per ogni combinazione interessante
 for policy in "${scheduling_policy[@]}"; do
   for combo in "${interesting_combinations[@]}"; do
     IFS=',' read -r c n <<< "$combo"
+    for pin in "${pinning[@]}"; do
+      pin_flag=""
+      if [ "$pin" != "none" ]; then
+        pin_flag="-p $pin"
+      fi
 
-    csv_line="collatz_par,$policy,$c,$n,$RANGE_VALUES"
-    echo "Running with -$policy -c $c -n $n $RANGE_VALUES"
-    for ((i = 1; i <= NUM_RUNS; i++)); do
-      output=$(./collatz_par -$policy -c $c -n $n $RANGE_VALUES 2>/dev/null)
-      current_run_time=$(echo "$output" | sed 's/.*: \(.*\)s/\1/')
-      csv_line="$csv_line,$current_run_time"
+      csv_line="collatz_par,$policy,$c,$n,$pin,$RANGE_VALUES"
+      echo "Running with -$policy -c $c -n $n $pin_flag $RANGE_VALUES"
+      for ((i = 1; i <= NUM_RUNS; i++)); do
+        output=$(./collatz_par -$policy -c $c -n $n $pin_flag $RANGE_VALUES 2>/dev/null)
+        current_run_time=$(echo "$output" | sed 's/.*: \(.*\)s/\1/')
+        csv_line="$csv_line,$current_run_time"
+      done
+      echo "$csv_line,$(run_statistics "$csv_line")" >> "$CSV_FILE"
     done
-    echo "$csv_line" >> "$CSV_FILE"
 
   done
 done
 
 # Run sequential version
-csv_line="collatz_seq,none,none,none,$RANGE_VALUES"
+csv_line="collatz_seq,none,none,none,none,$RANGE_VALUES"
 echo "Running collatz_seq $RANGE_VALUES"
 for ((i = 1; i <= NUM_RUNS; i++)); do
   output=$(./collatz_seq $RANGE_VALUES 2>/dev/null)
   current_run_time=$(echo "$output" | sed 's/.*: \(.*\)s/\1/')
   csv_line="$csv_line,$current_run_time"
 done
-echo "$csv_line" >> "$CSV_FILE"
+echo "$csv_line,$(run_statistics "$csv_line")" >> "$CSV_FILE"
@@ -0,0 +1,214 @@
+#include "autotune.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "block_cyclic_scheduling.hpp"
+#include "chunk_bounds.hpp"
+#include "collatz_fun.hpp"
+#include "collatz_reducers.hpp"
+#include "dynamic_TP_scheduling.hpp"
+#include "dynamic_index_scheduling.hpp"
+#include "hierarchical_scheduling.hpp"
+#include "threadPool.hpp"
+#include "thread_team.hpp"
+
+using namespace std;
+
+//elements timed over all the ranges, split evenly among them
+constexpr long AUTOTUNE_SAMPLE = 1L << 16;
+//every candidate is timed this many times, the best run counts
+constexpr int AUTOTUNE_REPETITIONS = 2;
+const SchedulingPolicy AUTOTUNE_POLICIES[] = {
+    STATIC_BLOCK_CYCLING, DYNAMIC_WITH_INDEX, HIERARCHICAL_INDEX, DYNAMIC_THREAD_POOL
+};
+const int AUTOTUNE_TASK_SIZES[] = {16, 64, 256, 1024, 4096, 16384};
+
+const char *policy_name(SchedulingPolicy policy) {
+    switch (policy) {
+        case STATIC_BLOCK_CYCLING:
+            return "static";
+        case DYNAMIC_WITH_INDEX:
+            return "dynamic";
+        case HIERARCHICAL_INDEX:
+            return "hierarchical";
+        case DYNAMIC_THREAD_POOL:
+            return "threadpool";
+        case OPENMP_LOOP:
+            return "openmp";
+        case PARALLEL_STL:
+            return "parallel-stl";
+    }
+    return "unknown";
+}
+
+static bool parse_policy_name(const string &name, SchedulingPolicy &policy) {
+    for (SchedulingPolicy candidate: AUTOTUNE_POLICIES) {
+        if (name == policy_name(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+//tabs removed since they separate the fields of the profile
+string cpu_model() {
+    ifstream cpuinfo("/proc/cpuinfo");
+    string line;
+    while (getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            string model = line.substr(line.find(':') + 2);
+            replace(model.begin(), model.end(), '\t', ' ');
+            return model;
+        }
+    }
+    return "unknown cpu";
+}
+
+//profile line: cpu model, threads, policy, task size (tab separated);
+//malformed lines are skipped and result is only written on a valid match
+static bool read_profile(const string &path, const string &model, int num_threads, AutotuneResult &result) {
+    ifstream profile(path);
+    string line;
+    while (getline(profile, line)) {
+        stringstream fields(line);
+        string line_model, threads, policy, task_size;
+        SchedulingPolicy line_policy;
+        if (!getline(fields, line_model, '\t') || !getline(fields, threads, '\t') ||
+            !getline(fields, policy, '\t') || !getline(fields, task_size, '\t') ||
+            line_model != model || threads != to_string(num_threads) ||
+            !parse_policy_name(policy, line_policy)) {
+            continue;
+        }
+        char *end;
+        errno = 0;
+        long line_task_size = strtol(task_size.c_str(), &end, 10);
+        if (end == task_size.c_str() || *end != '\0' || errno == ERANGE || line_task_size <= 0 ||
+            line_task_size > INT_MAX) {
+            continue;
+        }
+        result.policy = line_policy;
+        result.task_size = static_cast<int>(line_task_size);
+        result.cached = true;
+        return true;
+    }
+    return false;
+}
+
+//the profile is only appended to: read_profile takes the first match
+static void write_profile(const string &path, const string &model, int num_threads, const AutotuneResult &result) {
+    ofstream profile(path, ios::app);
+    profile << model << '\t' << num_threads << '\t' << policy_name(result.policy) << '\t'
+            << result.task_size << '\n';
+    if (!profile) {
+        fprintf(stderr, "warning: cannot write the autotune profile %s\n", path.c_str());
+    }
+}
+
+template<typename Run>
+static double best_time_ms(Run &&run) {
+    double best = 0;
+    for (int repetition = 0; repetition < AUTOTUNE_REPETITIONS; repetition++) {
+        auto start = chrono::steady_clock::now();
+        run();
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        best = repetition == 0 ? elapsed : min(best, elapsed);
+    }
+    return best;
+}
+
+AutotuneResult autotune(const RunningParam &running_param) {
+    const string model = cpu_model();
+    AutotuneResult result{STATIC_BLOCK_CYCLING, running_param.task_size, false, 0, 0};
+    if (read_profile(running_param.profile_path, model, running_param.num_threads, result)) {
+        return result;
+    }
+
+    //a prefix of every non-empty range
+    vector<pair<long, long> > sample;
+    long sample_size = 0;
+    const long per_range = max(1L, AUTOTUNE_SAMPLE / max<long>(1, running_param.ranges.size()));
+    for (const auto &range: running_param.ranges) {
+        if (range.first <= range.second) {
+            long last = chunk_last(range.first, per_range, range.second);
+            sample.emplace_back(range.first, last);
+            sample_size += last - range.first + 1;
+        }
+    }
+    if (sample.empty()) {
+        return result;
+    }
+
+    //per-element cost on one thread: the ideal parallel time is this over the
+    //threads that can actually run at once
+    MaxReducer reducer;
+    long maximum = reducer.identity();
+    double sequential_ms = best_time_ms([&] {
+        for (const auto &range: sample) {
+            reducer.accumulate(maximum, range.first, range.second);
+        }
+    });
+    //keep the sequential run from being optimized away
+    if (maximum < 0) {
+        fprintf(stderr, "autotune: empty sample\n");
+    }
+    result.ns_per_element = sequential_ms * 1e6 / sample_size;
+    const unsigned parallelism = max(1u, min<unsigned>(running_param.num_threads, thread::hardware_concurrency()));
+    const double ideal_ms = sequential_ms / parallelism;
+
+    ThreadTeam team(running_param.num_threads);
+    ThreadPool tp(running_param.num_threads);
+    const int num_groups = running_param.dispatch_groups > 0
+                               ? running_param.dispatch_groups
+                               : default_dispatch_groups(running_param.num_threads);
+    double best_ms = -1;
+    for (SchedulingPolicy policy: AUTOTUNE_POLICIES) {
+        for (int task_size: AUTOTUNE_TASK_SIZES) {
+            //chunks bigger than the share of a thread only unbalance the sample
+            if (task_size > 16 && task_size * running_param.num_threads > sample_size) {
+                continue;
+            }
+            double elapsed_ms = best_time_ms([&] {
+                for (const auto &range: sample) {
+                    switch (policy) {
+                        case STATIC_BLOCK_CYCLING:
+                            execute_static_scheduling(task_size, team, range, reducer);
+                            break;
+                        case DYNAMIC_WITH_INDEX:
+                            execute_dynamic_index_scheduling(task_size, team, range, reducer);
+                            break;
+                        case HIERARCHICAL_INDEX:
+                            execute_hierarchical_scheduling(task_size, num_groups, team, range, reducer);
+                            break;
+                        case DYNAMIC_THREAD_POOL:
+                            execute_dynamic_TP_scheduling(task_size, tp, range, PER_CHUNK_TASKS, reducer);
+                            break;
+                        default:
+                            //the standard runtimes are not candidates
+                            break;
+                    }
+                }
+            });
+            if (running_param.verbose) {
+                printf("autotune: %s -c %d: %.3f ms, overhead %.3f ms\n", policy_name(policy), task_size,
+                       elapsed_ms, elapsed_ms - ideal_ms);
+            }
+            if (best_ms < 0 || elapsed_ms < best_ms) {
+                best_ms = elapsed_ms;
+                result.policy = policy;
+                result.task_size = task_size;
+            }
+        }
+    }
+    result.overhead_ms = max(0.0, best_ms - ideal_ms);
+    write_profile(running_param.profile_path, model, running_param.num_threads, result);
+    return result;
+}
@@ -0,0 +1,105 @@
+#include "bench_report.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <unistd.h>
+#include "autotune.hpp"
+
+using namespace std;
+
+//normal quantile of the 95% interval
+constexpr double CI_Z = 1.96;
+
+SampleSummary summarize(vector<double> runs) {
+    if (runs.empty()) {
+        return {0, 0, 0};
+    }
+    sort(runs.begin(), runs.end());
+    const size_t n = runs.size();
+    double median = n % 2 ? runs[n / 2] : (runs[n / 2 - 1] + runs[n / 2]) / 2;
+    //1-based ranks of the interval bounds, clamped to the available runs
+    long low = static_cast<long>(floor((n - CI_Z * sqrt(n)) / 2));
+    long high = static_cast<long>(ceil(1 + (n + CI_Z * sqrt(n)) / 2));
+    low = clamp<long>(low, 1, n);
+    high = clamp<long>(high, 1, n);
+    return {median, runs[low - 1], runs[high - 1]};
+}
+
+BenchMachine bench_machine() {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    return {host, cpu_model(), thread::hardware_concurrency(), "g++ " __VERSION__, date};
+}
+
+static string json_string(const string &text) {
+    string quoted = "\"";
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static void write_json(FILE *out, const RunningParam &running_param, const string &command,
+                       const BenchMachine &machine, const vector<BenchMeasure> &measures) {
+    fprintf(out, "{\n  \"machine\": {\"host\": %s, \"cpu\": %s, \"hardware_threads\": %u, \"compiler\": %s, "
+            "\"date\": %s},\n", json_string(machine.host).c_str(), json_string(machine.cpu).c_str(),
+            machine.hardware_threads, json_string(machine.compiler).c_str(), json_string(machine.date).c_str());
+    fprintf(out, "  \"config\": {\"command\": %s, \"num_threads\": %d, \"task_size\": %d, \"warmup\": %d, "
+            "\"runs\": %d},\n", json_string(command).c_str(), running_param.num_threads,
+            running_param.task_size, running_param.bench_warmup, running_param.bench_runs);
+    fprintf(out, "  \"measures\": [\n");
+    for (size_t i = 0; i < measures.size(); i++) {
+        const BenchMeasure &measure = measures[i];
+        fprintf(out, "    {\"measure\": %s, \"policy\": %s, \"unit\": %s, \"median\": %g, \"ci_low\": %g, "
+                "\"ci_high\": %g, \"runs\": [", json_string(measure.measure).c_str(),
+                json_string(measure.policy).c_str(), json_string(measure.unit).c_str(), measure.summary.median,
+                measure.summary.ci_low, measure.summary.ci_high);
+        for (size_t run = 0; run < measure.runs.size(); run++) {
+            fprintf(out, "%s%g", run > 0 ? ", " : "", measure.runs[run]);
+        }
+        fprintf(out, "]}%s\n", i + 1 < measures.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void write_csv(FILE *out, const RunningParam &running_param, const string &command,
+                      const BenchMachine &machine, const vector<BenchMeasure> &measures) {
+    fprintf(out, "# host: %s\n# cpu: %s\n# hardware_threads: %u\n# compiler: %s\n# date: %s\n# command: %s\n",
+            machine.host.c_str(), machine.cpu.c_str(), machine.hardware_threads, machine.compiler.c_str(),
+            machine.date.c_str(), command.c_str());
+    fprintf(out, "measure,policy,num_threads,task_size,runs,unit,median,ci_low,ci_high\n");
+    for (const BenchMeasure &measure: measures) {
+        fprintf(out, "%s,%s,%d,%d,%zu,%s,%g,%g,%g\n", measure.measure.c_str(), measure.policy.c_str(),
+                running_param.num_threads, running_param.task_size, measure.runs.size(), measure.unit.c_str(),
+                measure.summary.median, measure.summary.ci_low, measure.summary.ci_high);
+    }
+}
+
+void write_bench_report(const RunningParam &running_param, const string &command,
+                        const vector<BenchMeasure> &measures) {
+    FILE *out = stdout;
+    if (!running_param.bench_output.empty()) {
+        out = fopen(running_param.bench_output.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "cannot write the benchmark report %s\n", running_param.bench_output.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+    const BenchMachine machine = bench_machine();
+    if (running_param.bench_format == CSV_REPORT) {
+        write_csv(out, running_param, command, machine, measures);
+    } else {
+        write_json(out, running_param, command, machine, measures);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+}
@@ -0,0 +1,81 @@
+#include "collatz_cache.hpp"
+#include <algorithm>
+
+using namespace std;
+
+static atomic<long> global_hits(0);
+static atomic<long> global_hash_hits(0);
+static atomic<long> global_misses(0);
+
+thread_local CollatzCacheCounters collatz_cache_counters;
+
+CollatzCacheCounters::~CollatzCacheCounters() {
+    global_hits += hits;
+    global_hash_hits += hash_hits;
+    global_misses += misses;
+}
+
+CollatzCache::CollatzCache(size_t budget_bytes, bool use_hash, long dense_bound)
+    : dense_bound(0), hash_mask(0) {
+    size_t dense_budget = use_hash ? budget_bytes / 2 : budget_bytes;
+    uint64_t dense_entries = dense_budget / sizeof(atomic<uint16_t>);
+    if (dense_bound > 0) {
+        dense_entries = min<uint64_t>(dense_entries, dense_bound);
+    }
+    if (dense_entries > 0) {
+        //value-initialization zeroes every slot (= unknown)
+        dense.reset(new atomic<uint16_t>[dense_entries]());
+        this->dense_bound = dense_entries;
+    }
+
+    if (use_hash) {
+        //largest power of two number of entries that fits the remaining budget
+        uint64_t hash_entries = 1;
+        while (hash_entries * 2 * sizeof(HashEntry) <= budget_bytes - dense_budget) {
+            hash_entries *= 2;
+        }
+        if (hash_entries > 1) {
+            hash.reset(new HashEntry[hash_entries]());
+            hash_mask = hash_entries - 1;
+        }
+    }
+}
+
+long CollatzCache::hash_lookup(uint64_t n) const {
+    uint64_t slot = hash_slot(n);
+    for (int probe = 0; probe < MAX_PROBES; probe++) {
+        const HashEntry &entry = hash[(slot + probe) & hash_mask];
+        uint64_t key = entry.key.load(memory_order_relaxed);
+        if (key == n) {
+            //0 when the writer has claimed the slot but not stored the length yet
+            return static_cast<long>(entry.length.load(memory_order_acquire)) - 1;
+        }
+        if (key == 0) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void CollatzCache::hash_insert(uint64_t n, long length) {
+    uint64_t slot = hash_slot(n);
+    for (int probe = 0; probe < MAX_PROBES; probe++) {
+        HashEntry &entry = hash[(slot + probe) & hash_mask];
+        uint64_t key = entry.key.load(memory_order_relaxed);
+        if (key == 0 && entry.key.compare_exchange_strong(key, n, memory_order_relaxed)) {
+            key = n;
+        }
+        if (key == n) {
+            entry.length.store(static_cast<uint32_t>(length + 1), memory_order_release);
+            return;
+        }
+    }
+}
+
+CollatzCacheStats CollatzCache::stats() const {
+    return {global_hits.load() + collatz_cache_counters.hits,
+            global_hash_hits.load() + collatz_cache_counters.hash_hits,
+            global_misses.load() + collatz_cache_counters.misses,
+            static_cast<long>(dense_bound),
+            hash ? static_cast<long>(hash_mask + 1) : 0};
+}
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mpi.h>
+#include <vector>
+#include "block_cyclic_scheduling.hpp"
+#include "boundedThreadPool.hpp"
+#include "chunk_bounds.hpp"
+#include "collatz_cache.hpp"
+#include "collatz_fun.hpp"
+#include "collatz_reducers.hpp"
+#include "dynamic_TP_scheduling.hpp"
+#include "dynamic_index_scheduling.hpp"
+#include "hierarchical_scheduling.hpp"
+#include "openmp_scheduling.hpp"
+#include "parallel_stl_scheduling.hpp"
+#include "parse_utility.hpp"
+#include "threadPool.hpp"
+#include "thread_team.hpp"
+#include "workStealingThreadPool.hpp"
+
+using namespace std;
+
+// Distributed version of collatz_par. Rank 0 is the master: it cuts the
+// ranges in pieces and hands them out one at a time to the worker ranks
+// that ask for work, so faster (or less loaded) ranks take more pieces.
+// Every worker folds its pieces with the intra-node policy selected on the
+// command line (-s, -d, -t, -g, -o, -e), keeping one argmax per range, and the
+// per-range results are combined on rank 0 with MPI_Reduce.
+// With a single rank, rank 0 runs all the pieces itself.
+
+#define MPI_SAFE_CALL(call, MPI_COMM) do {                                  \
+    int err = (call);                                                       \
+    if (err != MPI_SUCCESS) {                                               \
+        char errstr[MPI_MAX_ERROR_STRING];                                  \
+        int errlen = 0;                                                     \
+        MPI_Error_string(err, errstr, &errlen);                             \
+        fprintf(stderr,                                                     \
+        "MPI error in %s\n"                                                 \
+        "  Code: %d (%.*s)\n"                                               \
+        "  Location: %s:%d\n",                                              \
+        #call, err, errlen, errstr, __FILE__, __LINE__);                    \
+        MPI_Abort(MPI_COMM, err);                                           \
+        std::abort();                                                       \
+    }                                                                       \
+} while (0)
+
+//worker -> master: ask for the next piece
+constexpr int TAG_REQUEST = 1;
+//master -> worker: {range index, first, last}
+constexpr int TAG_PIECE = 2;
+//master -> worker: no pieces left
+constexpr int TAG_STOP = 3;
+
+//chunks of -c elem per thread in a piece: pieces have to be large enough to
+//hide the round trip to the master and small enough to balance the ranks
+constexpr long CHUNKS_PER_THREAD = 64;
+constexpr long MIN_PIECE_SIZE = 1 << 16;
+
+void init_MPI_threads_checks(int argc, char **argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+        fprintf(stderr, "MPI does not provide required threading support\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        abort();
+    }
+    int is_main_flag;
+    MPI_Is_thread_main(&is_main_flag);
+    if (!is_main_flag) {
+        fprintf(stderr, "This thread called MPI_Init_thread but it is not the main thread\n");
+        MPI_Abort(MPI_COMM_WORLD, -1);
+        abort();
+    }
+}
+
+int get_my_rank(MPI_Comm COMM) {
+    int rank;
+    MPI_SAFE_CALL(MPI_Comm_rank(COMM, &rank), COMM);
+    return rank;
+}
+
+int get_number_of_nodes(MPI_Comm COMM) {
+    int size;
+    MPI_SAFE_CALL(MPI_Comm_size(COMM, &size), COMM);
+    return size;
+}
+
+//CollatzArgMax as two contiguous longs
+MPI_Datatype create_mpi_argmax_type() {
+    MPI_Datatype MPI_ARGMAX_TYPE;
+    MPI_SAFE_CALL(MPI_Type_contiguous(2, MPI_LONG, &MPI_ARGMAX_TYPE), MPI_COMM_WORLD);
+    MPI_SAFE_CALL(MPI_Type_commit(&MPI_ARGMAX_TYPE), MPI_COMM_WORLD);
+    return MPI_ARGMAX_TYPE;
+}
+
+void combine_argmax(void *in, void *inout, int *len, MPI_Datatype *) {
+    const CollatzArgMax *other = static_cast<const CollatzArgMax *>(in);
+    CollatzArgMax *best = static_cast<CollatzArgMax *>(inout);
+    ArgMaxReducer reducer;
+    for (int i = 0; i < *len; i++) {
+        reducer.combine(best[i], other[i]);
+    }
+}
+
+//ties go to the smaller n: the result does not depend on the order
+MPI_Op create_mpi_argmax_op() {
+    MPI_Op MPI_ARGMAX_OP;
+    MPI_SAFE_CALL(MPI_Op_create(combine_argmax, 1, &MPI_ARGMAX_OP), MPI_COMM_WORLD);
+    return MPI_ARGMAX_OP;
+}
+
+//folds the pieces of this rank with the intra-node policy: the team or
+//the pool is created once and reused for every piece
+class PieceRunner {
+    const RunningParam &running_param;
+    ArgMaxReducer reducer;
+    unique_ptr<ThreadTeam> team;
+    unique_ptr<ThreadPool> pool;
+    unique_ptr<WorkStealingThreadPool> ws_pool;
+    unique_ptr<BoundedThreadPool> bounded_pool;
+    int num_groups;
+
+public:
+    explicit PieceRunner(const RunningParam &running_param_) : running_param(running_param_), num_groups(1) {
+        if (running_param.scheduling_policy == OPENMP_LOOP || running_param.scheduling_policy == PARALLEL_STL) {
+            //the runtime keeps its own threads
+        } else if (running_param.scheduling_policy != DYNAMIC_THREAD_POOL) {
+            team.reset(new ThreadTeam(running_param.num_threads));
+            num_groups = running_param.dispatch_groups > 0
+                             ? running_param.dispatch_groups
+                             : default_dispatch_groups(running_param.num_threads);
+        } else if (running_param.work_stealing) {
+            ws_pool.reset(new WorkStealingThreadPool(running_param.num_threads));
+        } else if (running_param.queue_capacity > 0) {
+            bounded_pool.reset(new BoundedThreadPool(running_param.num_threads, running_param.queue_capacity));
+        } else {
+            pool.reset(new ThreadPool(running_param.num_threads));
+        }
+    }
+
+    CollatzArgMax run(const pair<long, long> &piece) {
+        const int task_size = running_param.task_size;
+        switch (running_param.scheduling_policy) {
+            case STATIC_BLOCK_CYCLING:
+                return execute_static_scheduling(task_size, *team, piece, reducer);
+            case DYNAMIC_WITH_INDEX:
+                return execute_dynamic_index_scheduling(task_size, *team, piece, reducer);
+            case HIERARCHICAL_INDEX:
+                return execute_hierarchical_scheduling(task_size, num_groups, *team, piece, reducer);
+            case DYNAMIC_THREAD_POOL:
+                if (ws_pool) {
+                    return execute_dynamic_TP_scheduling(task_size, *ws_pool, piece,
+                                                         running_param.tp_submission, reducer);
+                }
+                if (bounded_pool) {
+                    return execute_dynamic_TP_scheduling(task_size, *bounded_pool, piece,
+                                                         running_param.tp_submission, reducer);
+                }
+                return execute_dynamic_TP_scheduling(task_size, *pool, piece, running_param.tp_submission,
+                                                     reducer, running_param.priority_tail);
+            case OPENMP_LOOP:
+                return execute_openmp_scheduling(task_size, running_param.num_threads, running_param.omp_schedule,
+                                                 piece, reducer);
+            case PARALLEL_STL:
+                return execute_parallel_stl_scheduling(task_size, running_param.num_threads, piece, reducer);
+        }
+        return reducer.identity();
+    }
+};
+
+//the pieces of all the ranges, in command-line order, cut one at a time
+//when asked for: memory does not depend on the size of the ranges
+class PieceCursor {
+    const vector<pair<long, long> > &ranges;
+    long piece_size;
+    size_t r;
+    long first;
+
+    //move to the first non-empty range from r on
+    void skip_empty_ranges() {
+        while (r < ranges.size() && ranges[r].first > ranges[r].second) {
+            r++;
+        }
+        if (r < ranges.size()) {
+            first = ranges[r].first;
+        }
+    }
+
+public:
+    explicit PieceCursor(const RunningParam &running_param)
+        : ranges(running_param.ranges),
+          piece_size(max(MIN_PIECE_SIZE, CHUNKS_PER_THREAD * running_param.task_size * running_param.num_threads)),
+          r(0), first(0) {
+        skip_empty_ranges();
+    }
+
+    //{range index, first, last} of the next piece, false once all are out
+    bool next(array<long, 3> &piece) {
+        if (r >= ranges.size()) {
+            return false;
+        }
+        long last = chunk_last(first, piece_size, ranges[r].second);
+        piece = {static_cast<long>(r), first, last};
+        //the step past the last piece is not taken: it can end at LONG_MAX
+        if (last == ranges[r].second) {
+            r++;
+            skip_empty_ranges();
+        } else {
+            first = last + 1;
+        }
+        return true;
+    }
+};
+
+//hand out the pieces on request, then stop every worker
+void run_master(PieceCursor &pieces, int number_of_nodes) {
+    int stopped = 0;
+    while (stopped < number_of_nodes - 1) {
+        MPI_Status status;
+        MPI_SAFE_CALL(MPI_Recv(nullptr, 0, MPI_LONG, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status),
+                      MPI_COMM_WORLD);
+        array<long, 3> piece;
+        if (pieces.next(piece)) {
+            MPI_SAFE_CALL(MPI_Send(piece.data(), 3, MPI_LONG, status.MPI_SOURCE, TAG_PIECE,
+                                   MPI_COMM_WORLD), MPI_COMM_WORLD);
+        } else {
+            MPI_SAFE_CALL(MPI_Send(nullptr, 0, MPI_LONG, status.MPI_SOURCE, TAG_STOP, MPI_COMM_WORLD),
+                          MPI_COMM_WORLD);
+            stopped++;
+        }
+    }
+}
+
+//ask for pieces until the master has none left, folding them per range;
+//returns the number of pieces processed
+long run_worker(PieceRunner &runner, vector<CollatzArgMax> &results) {
+    ArgMaxReducer reducer;
+    long processed = 0;
+    while (true) {
+        array<long, 3> piece;
+        MPI_Status status;
+        MPI_SAFE_CALL(MPI_Send(nullptr, 0, MPI_LONG, 0, TAG_REQUEST, MPI_COMM_WORLD), MPI_COMM_WORLD);
+        MPI_SAFE_CALL(MPI_Recv(piece.data(), 3, MPI_LONG, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status),
+                      MPI_COMM_WORLD);
+        if (status.MPI_TAG == TAG_STOP) {
+            return processed;
+        }
+        reducer.combine(results[piece[0]], runner.run({piece[1], piece[2]}));
+        processed++;
+    }
+}
+
+//same line as collatz_seq and collatz_par (0 for an empty range), so the
+//outputs can be diffed; with -v the argmax follows on stdout
+void print_range_result(const pair<long, long> &range, const CollatzArgMax &best, bool verbose) {
+    fprintf(stderr, "%ld-%ld: %ld\n", range.first, range.second, max(best.length, 0L));
+    if (verbose && best.length >= 0) {
+        printf("%ld-%ld: longest at n = %ld\n", range.first, range.second, best.n);
+    }
+}
+
+int main(int argc, char **argv) {
+    init_MPI_threads_checks(argc, argv);
+    const int rank = get_my_rank(MPI_COMM_WORLD);
+    const int number_of_nodes = get_number_of_nodes(MPI_COMM_WORLD);
+    RunningParam running_param = parse_running_param(argc, argv);
+    if (rank == 0 && (running_param.autotune || running_param.statistics || running_param.batch_ranges)) {
+        fprintf(stderr, "warning: --autotune, -a and -r are ignored by collatz_mpi\n");
+    }
+    collatz_kernel = running_param.kernel;
+    if (collatz_kernel == TABLE_KERNEL) {
+        collatz_step_table();
+    }
+    if (collatz_kernel == SIEVE_KERNEL) {
+        sieve_base_table();
+    }
+    //one cache per rank: ranks may live on different nodes
+    unique_ptr<CollatzCache> cache;
+    if (running_param.cache_budget_mb > 0) {
+        cache.reset(new CollatzCache(running_param.cache_budget_mb << 20, running_param.cache_hash,
+                                     running_param.cache_dense_bound));
+        collatz_cache = cache.get();
+    }
+    MPI_Datatype MPI_ARGMAX_TYPE = create_mpi_argmax_type();
+    MPI_Op MPI_ARGMAX_OP = create_mpi_argmax_op();
+    ArgMaxReducer reducer;
+    vector<CollatzArgMax> results(running_param.ranges.size(), reducer.identity());
+    vector<CollatzArgMax> global_results(results.size(), reducer.identity());
+    long processed = 0;
+    {
+        //the master does not compute: its threads would only compete with
+        //the workers sharing its node
+        unique_ptr<PieceRunner> runner;
+        if (rank != 0 || number_of_nodes == 1) {
+            runner.reset(new PieceRunner(running_param));
+        }
+        MPI_SAFE_CALL(MPI_Barrier(MPI_COMM_WORLD), MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        PieceCursor pieces(running_param);
+        if (number_of_nodes == 1) {
+            array<long, 3> piece;
+            while (pieces.next(piece)) {
+                reducer.combine(results[piece[0]], runner->run({piece[1], piece[2]}));
+                processed++;
+            }
+        } else if (rank == 0) {
+            run_master(pieces, number_of_nodes);
+        } else {
+            processed = run_worker(*runner, results);
+        }
+        MPI_SAFE_CALL(MPI_Reduce(results.data(), global_results.data(), results.size(), MPI_ARGMAX_TYPE,
+                                 MPI_ARGMAX_OP, 0, MPI_COMM_WORLD), MPI_COMM_WORLD);
+        double elapsed = MPI_Wtime() - start;
+        if (rank == 0) {
+            for (size_t r = 0; r < global_results.size(); r++) {
+                print_range_result(running_param.ranges[r], global_results[r], running_param.verbose);
+            }
+            printf("# elapsed time (collatz_mpi): %gs\n", elapsed);
+        }
+    }
+    if (running_param.verbose) {
+        vector<long> pieces_per_rank(number_of_nodes);
+        MPI_SAFE_CALL(MPI_Gather(&processed, 1, MPI_LONG, pieces_per_rank.data(), 1, MPI_LONG, 0,
+                                 MPI_COMM_WORLD), MPI_COMM_WORLD);
+        if (rank == 0) {
+            for (int r = 0; r < number_of_nodes; r++) {
+                printf("rank %d: %ld pieces\n", r, pieces_per_rank[r]);
+            }
+        }
+    }
+    MPI_Op_free(&MPI_ARGMAX_OP);
+    MPI_Type_free(&MPI_ARGMAX_TYPE);
+    MPI_Finalize();
+    return 0;
+}
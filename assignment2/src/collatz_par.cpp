@@ -1,15 +1,30 @@
 #include <cstdio>
-#include <future>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <vector>
+#include "autotune.hpp"
+#include "bench_report.hpp"
 #include "block_cyclic_scheduling.hpp"
+#include "boundedThreadPool.hpp"
+#include "collatz_cache.hpp"
+#include "collatz_fun.hpp"
+#include "collatz_reducers.hpp"
 #include "dynamic_TP_scheduling.hpp"
 #include "dynamic_index_scheduling.hpp"
+#include "hierarchical_scheduling.hpp"
 #include "hpc_helpers.hpp"
+#include "openmp_scheduling.hpp"
+#include "parallel_stl_scheduling.hpp"
+#include "range_batch_scheduling.hpp"
+#include "thread_affinity.hpp"
 #include "threadPool.hpp"
+#include "trace.hpp"
+#include "thread_team.hpp"
+#include "workStealingThreadPool.hpp"
 #include "parse_utility.hpp"
 
 using namespace std;
@@ -22,33 +37,379 @@ void debug_run_parsed_param(const RunningParam &running_param) {
     }
 }
 
+void print_range_result(const pair<long, long> &range, long maximum) {
+    fprintf(stderr, "%ld-%ld: %ld\n", range.first, range.second, maximum);
+}
 
-int main(int argc, char **argv) {
-    RunningParam running_param = parse_running_param(argc, argv);
-    //debug_run_parsed_param(runningParam);
-    TIMERSTART(collatz_par);
+//maximum line as above followed by the argmax, the peak and the non-empty
+//histogram bins (length:count)
+void print_range_result(const pair<long, long> &range, const CollatzStats &stats) {
+    if (stats.longest.length < 0) {
+        fprintf(stderr, "%ld-%ld: 0 (empty)\n", range.first, range.second);
+        return;
+    }
+    fprintf(stderr, "%ld-%ld: %ld (n = %ld), peak %s (n = %ld)\n", range.first, range.second,
+            stats.longest.length, stats.longest.n, uint128_to_string(stats.peak).c_str(), stats.peak_n);
+    fprintf(stderr, "%ld-%ld histogram:", range.first, range.second);
+    for (size_t length = 0; length < stats.histogram.size(); length++) {
+        if (stats.histogram[length] > 0) {
+            fprintf(stderr, " %zu:%ld", length, stats.histogram[length]);
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+//run_range(range) for every range, or run_batch(ranges) once for all of
+//them, printing the results in command-line order (unless --bench)
+template<typename RunRange, typename RunBatch>
+void run_ranges(const RunningParam &running_param, RunRange &&run_range, RunBatch &&run_batch) {
+    const bool print_results = running_param.bench_runs == 0;
+    if (running_param.batch_ranges) {
+        auto results = run_batch(running_param.ranges);
+        for (size_t r = 0; print_results && r < results.size(); r++) {
+            print_range_result(running_param.ranges[r], results[r]);
+        }
+        return;
+    }
+    for (const auto &range: running_param.ranges) {
+        auto result = run_range(range);
+        if (print_results) {
+            print_range_result(range, result);
+        }
+    }
+}
+
+//-r for the standard runtimes, which have no batched form: one range at a time
+template<typename RunRange>
+auto run_each_range(const vector<pair<long, long> > &ranges, RunRange &&run_range) {
+    vector<decltype(run_range(ranges[0]))> results;
+    for (const auto &range: ranges) {
+        results.push_back(run_range(range));
+    }
+    return results;
+}
+
+template<typename Pool, typename Reducer>
+void run_dynamic_TP_scheduling(Pool &tp, const vector<int> &cpu_map, const RunningParam &running_param,
+                               const Reducer &reducer) {
+    if (!tp.pin_workers(cpu_map)) {
+        fprintf(stderr, "warning: some threads could not be pinned\n");
+    }
+    run_ranges(running_param,
+               [&](const pair<long, long> &range) {
+                   return execute_dynamic_TP_scheduling(running_param.task_size, tp, range,
+                                                        running_param.tp_submission, reducer,
+                                                        running_param.priority_tail);
+               },
+               [&](const vector<pair<long, long> > &ranges) {
+                   return execute_batched_TP_scheduling(running_param.task_size, tp, ranges, reducer);
+               });
+}
+
+//queue wait time of the tasks of every priority level that was used
+void print_queue_wait(ThreadPool &tp) {
+    const char *names[] = {"high", "normal", "low"};
+    for (uint32_t level = 0; level < ThreadPool::PRIORITY_LEVELS; level++) {
+        ThreadPool::QueueWaitStats stats = tp.queue_wait_stats(static_cast<ThreadPool::Priority>(level));
+        if (stats.tasks > 0) {
+            printf("queue wait %s: %lu tasks, mean %.2f us, max %.2f us\n", names[level],
+                   (unsigned long) stats.tasks, stats.total_wait_us / stats.tasks, stats.max_wait_us);
+        }
+    }
+}
+
+void pin_team(ThreadTeam &team, const vector<int> &cpu_map) {
+    if (!team.pin_members(cpu_map)) {
+        fprintf(stderr, "warning: some threads could not be pinned\n");
+    }
+}
+
+//run the selected policy over all the ranges, folding them with reducer
+template<typename Reducer>
+void run_scheduling(const RunningParam &running_param, const vector<int> &cpu_map, const Reducer &reducer) {
     switch (running_param.scheduling_policy) {
-        case DYNAMIC_THREAD_POOL: {
-            ThreadPool tp(running_param.num_threads);
-            for (const auto &range: running_param.ranges) {
-                execute_dynamic_TP_scheduling(running_param.task_size, tp, range);
+        case DYNAMIC_THREAD_POOL:
+            if (running_param.work_stealing) {
+                WorkStealingThreadPool tp(running_param.num_threads);
+                //the pools print their stats summary when destroyed
+                tp.enable_stats(running_param.pool_stats);
+                run_dynamic_TP_scheduling(tp, cpu_map, running_param, reducer);
+            } else if (running_param.queue_capacity > 0) {
+                //submission blocks while the ring is full: memory stays bounded
+                const uint32_t spins = running_param.wait_spins >= 0 ? running_param.wait_spins
+                                                                      : BoundedThreadPool::DEFAULT_SPIN_ITERATIONS;
+                const uint32_t yields = running_param.wait_spins != 0 ? BoundedThreadPool::DEFAULT_YIELD_ITERATIONS : 0;
+                BoundedThreadPool tp(running_param.num_threads, running_param.queue_capacity, spins, yields);
+                tp.enable_stats(running_param.pool_stats);
+                run_dynamic_TP_scheduling(tp, cpu_map, running_param, reducer);
+            } else {
+                const uint32_t spins = running_param.wait_spins >= 0 ? running_param.wait_spins
+                                                                      : ThreadPool::DEFAULT_SPIN_ITERATIONS;
+                const uint32_t yields = running_param.wait_spins != 0 ? ThreadPool::DEFAULT_YIELD_ITERATIONS : 0;
+                ThreadPool tp(running_param.num_threads, ThreadPool::DEFAULT_STARVATION_LIMIT, spins, yields);
+                tp.track_queue_wait(running_param.verbose);
+                tp.enable_stats(running_param.pool_stats);
+                run_dynamic_TP_scheduling(tp, cpu_map, running_param, reducer);
+                if (running_param.verbose) {
+                    print_queue_wait(tp);
+                }
             }
+            break;
+        case DYNAMIC_WITH_INDEX: {
+            //threads created once and reused for every range
+            ThreadTeam team(running_param.num_threads);
+            pin_team(team, cpu_map);
+            run_ranges(running_param,
+                       [&](const pair<long, long> &range) {
+                           return execute_dynamic_index_scheduling(running_param.task_size, team, range,
+                                                                   reducer);
+                       },
+                       [&](const vector<pair<long, long> > &ranges) {
+                           return execute_batched_scheduling(DYNAMIC_WITH_INDEX, running_param.task_size,
+                                                             team, ranges, reducer);
+                       });
+            break;
         }
-        break;
-        case DYNAMIC_WITH_INDEX:
-            for (const auto &range: running_param.ranges) {
-                execute_dynamic_index_scheduling(running_param.task_size,
-                                                 running_param.num_threads, range);
-            }
+        case STATIC_BLOCK_CYCLING: {
+            ThreadTeam team(running_param.num_threads);
+            pin_team(team, cpu_map);
+            run_ranges(running_param,
+                       [&](const pair<long, long> &range) {
+                           return execute_static_scheduling(running_param.task_size, team, range, reducer);
+                       },
+                       [&](const vector<pair<long, long> > &ranges) {
+                           return execute_batched_scheduling(STATIC_BLOCK_CYCLING, running_param.task_size,
+                                                             team, ranges, reducer);
+                       });
             break;
-        case STATIC_BLOCK_CYCLING:
-            for (const auto &range: running_param.ranges) {
-                execute_static_scheduling(running_param.task_size,
-                                          running_param.num_threads, range);
-            }
+        }
+        case HIERARCHICAL_INDEX: {
+            ThreadTeam team(running_param.num_threads);
+            pin_team(team, cpu_map);
+            const int num_groups = running_param.dispatch_groups > 0
+                                       ? running_param.dispatch_groups
+                                       : default_dispatch_groups(running_param.num_threads);
+            run_ranges(running_param,
+                       [&](const pair<long, long> &range) {
+                           return execute_hierarchical_scheduling(running_param.task_size, num_groups, team,
+                                                                  range, reducer);
+                       },
+                       [&](const vector<pair<long, long> > &ranges) {
+                           return execute_batched_scheduling(HIERARCHICAL_INDEX, running_param.task_size,
+                                                             team, ranges, reducer, num_groups);
+                       });
+            break;
+        }
+        case OPENMP_LOOP: {
+            //the OpenMP runtime places its own threads (OMP_PROC_BIND, OMP_PLACES)
+            auto run_range = [&](const pair<long, long> &range) {
+                return execute_openmp_scheduling(running_param.task_size, running_param.num_threads,
+                                                 running_param.omp_schedule, range, reducer);
+            };
+            run_ranges(running_param, run_range, [&](const vector<pair<long, long> > &ranges) {
+                return run_each_range(ranges, run_range);
+            });
+            break;
+        }
+        case PARALLEL_STL: {
+            auto run_range = [&](const pair<long, long> &range) {
+                return execute_parallel_stl_scheduling(running_param.task_size, running_param.num_threads, range,
+                                                       reducer);
+            };
+            run_ranges(running_param, run_range, [&](const vector<pair<long, long> > &ranges) {
+                return run_each_range(ranges, run_range);
+            });
             break;
+        }
         default:
             printf("UNKNOWN\n");
     }
+}
+
+//chunks handed out per run by the dispatch overhead benchmark
+constexpr long OVERHEAD_CHUNKS = 1 << 16;
+
+template<typename Run>
+BenchMeasure dispatch_measure(const RunningParam &running_param, SchedulingPolicy policy, Run &&run) {
+    vector<double> runs = time_runs(running_param.bench_warmup, running_param.bench_runs, run);
+    for (double &run_time: runs) {
+        run_time = run_time * 1e9 / OVERHEAD_CHUNKS;
+    }
+    return {"dispatch", policy_name(policy), runs, summarize(runs), "ns/chunk"};
+}
+
+template<typename Pool>
+BenchMeasure pool_dispatch_measure(const RunningParam &running_param, Pool &tp, const pair<long, long> &range) {
+    return dispatch_measure(running_param, DYNAMIC_THREAD_POOL, [&] {
+        execute_dynamic_TP_scheduling(running_param.task_size, tp, range, running_param.tp_submission,
+                                      ChunkCountReducer(), running_param.priority_tail);
+    });
+}
+
+//every policy handing out OVERHEAD_CHUNKS chunks of -c elem that do no
+//collatz work: what is left is the dispatcher cost. The team and the pools
+//are created once, outside of the timed runs
+vector<BenchMeasure> measure_dispatch_overhead(const RunningParam &running_param) {
+    const pair<long, long> range{1, OVERHEAD_CHUNKS * running_param.task_size};
+    const int task_size = running_param.task_size;
+    ChunkCountReducer reducer;
+    vector<BenchMeasure> measures;
+    {
+        ThreadTeam team(running_param.num_threads);
+        const int num_groups = running_param.dispatch_groups > 0
+                                   ? running_param.dispatch_groups
+                                   : default_dispatch_groups(running_param.num_threads);
+        measures.push_back(dispatch_measure(running_param, STATIC_BLOCK_CYCLING, [&] {
+            execute_static_scheduling(task_size, team, range, reducer);
+        }));
+        measures.push_back(dispatch_measure(running_param, DYNAMIC_WITH_INDEX, [&] {
+            execute_dynamic_index_scheduling(task_size, team, range, reducer);
+        }));
+        measures.push_back(dispatch_measure(running_param, HIERARCHICAL_INDEX, [&] {
+            execute_hierarchical_scheduling(task_size, num_groups, team, range, reducer);
+        }));
+    }
+    measures.push_back(dispatch_measure(running_param, OPENMP_LOOP, [&] {
+        execute_openmp_scheduling(task_size, running_param.num_threads, running_param.omp_schedule, range, reducer);
+    }));
+    measures.push_back(dispatch_measure(running_param, PARALLEL_STL, [&] {
+        execute_parallel_stl_scheduling(task_size, running_param.num_threads, range, reducer);
+    }));
+    //the pool selected by -w/-q, as run_scheduling does
+    if (running_param.work_stealing) {
+        WorkStealingThreadPool tp(running_param.num_threads);
+        measures.push_back(pool_dispatch_measure(running_param, tp, range));
+    } else if (running_param.queue_capacity > 0) {
+        BoundedThreadPool tp(running_param.num_threads, running_param.queue_capacity);
+        measures.push_back(pool_dispatch_measure(running_param, tp, range));
+    } else {
+        ThreadPool tp(running_param.num_threads);
+        measures.push_back(pool_dispatch_measure(running_param, tp, range));
+    }
+    return measures;
+}
+
+//memo table of -m, null when disabled
+unique_ptr<CollatzCache> make_collatz_cache(const RunningParam &running_param) {
+    if (running_param.cache_budget_mb <= 0) {
+        return nullptr;
+    }
+    return unique_ptr<CollatzCache>(new CollatzCache(running_param.cache_budget_mb << 20, running_param.cache_hash,
+                                                     running_param.cache_dense_bound));
+}
+
+//--bench: the sequential loop and the selected policy (team or pool
+//creation included, as in the timed region of a normal run), the speedup
+//of the medians and the dispatch overhead of every policy
+void run_benchmark(const RunningParam &running_param, const vector<int> &cpu_map, const string &command) {
+    //with -m every run starts from an empty memo table, as a normal run
+    //does: a table kept across the runs would turn them into lookups
+    unique_ptr<CollatzCache> cache;
+    auto fresh_cache = [&] {
+        if (running_param.cache_budget_mb > 0) {
+            collatz_cache = nullptr;
+            cache.reset();
+            cache = make_collatz_cache(running_param);
+            collatz_cache = cache.get();
+        }
+    };
+    MaxReducer reducer;
+    long maximum = reducer.identity();
+    vector<double> sequential = time_runs(running_param.bench_warmup, running_param.bench_runs, fresh_cache, [&] {
+        for (const auto &range: running_param.ranges) {
+            reducer.accumulate(maximum, range.first, range.second);
+        }
+    });
+    //keep the sequential runs from being optimized away
+    if (maximum < 0) {
+        fprintf(stderr, "bench: no range\n");
+    }
+    vector<double> parallel = time_runs(running_param.bench_warmup, running_param.bench_runs, fresh_cache, [&] {
+        if (running_param.statistics) {
+            run_scheduling(running_param, cpu_map, CollatzStatsReducer());
+        } else {
+            run_scheduling(running_param, cpu_map, MaxReducer());
+        }
+    });
+    const char *policy = policy_name(running_param.scheduling_policy);
+    vector<BenchMeasure> measures;
+    measures.push_back({"sequential", "sequential", sequential, summarize(sequential), "s"});
+    measures.push_back({"parallel", policy, parallel, summarize(parallel), "s"});
+    const SampleSummary &seq = measures[0].summary;
+    const SampleSummary &par = measures[1].summary;
+    measures.push_back({"speedup", policy, {},
+                        {seq.median / par.median, seq.ci_low / par.ci_high, seq.ci_high / par.ci_low}, "x"});
+    for (BenchMeasure &measure: measure_dispatch_overhead(running_param)) {
+        measures.push_back(measure);
+    }
+    collatz_cache = nullptr;
+    write_bench_report(running_param, command, measures);
+}
+
+int main(int argc, char **argv) {
+    RunningParam running_param = parse_running_param(argc, argv);
+    //debug_run_parsed_param(runningParam);
+    collatz_kernel = running_param.kernel;
+    if (collatz_kernel == TABLE_KERNEL) {
+        //build the jump table outside of the timed region
+        collatz_step_table();
+    }
+    if (collatz_kernel == SIEVE_KERNEL) {
+        sieve_base_table();
+    }
+    if (running_param.autotune) {
+        //tuned before the cache exists: the samples must not warm it up
+        AutotuneResult tuned = autotune(running_param);
+        running_param.scheduling_policy = tuned.policy;
+        running_param.task_size = tuned.task_size;
+        if (tuned.cached) {
+            printf("autotune: %s -c %d (from %s)\n", policy_name(tuned.policy), tuned.task_size,
+                   running_param.profile_path.c_str());
+        } else {
+            printf("autotune: %s -c %d (%.2f ns per element, overhead %.3f ms)\n", policy_name(tuned.policy),
+                   tuned.task_size, tuned.ns_per_element, tuned.overhead_ms);
+        }
+    }
+    vector<int> cpu_map = build_cpu_map(running_param.pinning, running_param.cpu_list);
+    if (running_param.verbose) {
+        print_cpu_map(cpu_map, running_param.num_threads);
+    }
+    if (!running_param.trace_path.empty()) {
+        //after autotune: only the runs below are traced
+        trace_enable(running_param.trace_path);
+    }
+    if (running_param.bench_runs > 0) {
+        string command = argv[0];
+        for (int i = 1; i < argc; i++) {
+            command += string(" ") + argv[i];
+        }
+        run_benchmark(running_param, cpu_map, command);
+        return 0;
+    }
+    unique_ptr<CollatzCache> cache = make_collatz_cache(running_param);
+    collatz_cache = cache.get();
+    TIMERSTART(collatz_par);
+    if (running_param.statistics) {
+        run_scheduling(running_param, cpu_map, CollatzStatsReducer());
+    } else {
+        run_scheduling(running_param, cpu_map, MaxReducer());
+    }
     TIMERSTOP(collatz_par);
+    if (cache && running_param.verbose) {
+        CollatzCacheStats stats = cache->stats();
+        long lookups = stats.hits + stats.misses;
+        printf("cache: dense entries %ld, hash entries %ld, hits %ld/%ld (%.2f%%), hash hits %ld\n",
+               stats.dense_entries, stats.hash_entries, stats.hits, lookups,
+               lookups > 0 ? 100.0 * stats.hits / lookups : 0.0, stats.hash_hits);
+    }
+    if (collatz_kernel == SIMD_KERNEL && running_param.verbose) {
+        SimdLaneStats stats = simd_lane_stats();
+        printf("simd: %d lanes, utilization %.2f%%\n", stats.lanes,
+               stats.total_lane_steps > 0 ? 100.0 * stats.active_lane_steps / stats.total_lane_steps : 0.0);
+    }
+    if (running_param.verbose) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("peak rss: %ld KB\n", usage.ru_maxrss);
+    }
 }
@@ -7,10 +7,11 @@
 
 long find_max_collatz_seq_in_range(std::pair<long, long> range) {
     long global_max = 0;
-    for (long i = range.first; i <= range.second; i++) {
+    //stops on range.second: it can be LONG_MAX
+    for_each_in_range(range.first, range.second, [&global_max](long i) {
         long collatz_length = calculate_collatz_length(i);
         global_max = std::max(global_max, collatz_length);
-    }
+    });
     return global_max;
 }
 
@@ -0,0 +1,20 @@
+#include "collatz_simd.hpp"
+#include <atomic>
+
+using namespace std;
+
+static atomic<long> global_active_lane_steps(0);
+static atomic<long> global_total_lane_steps(0);
+
+thread_local SimdLaneCounters simd_lane_counters;
+
+SimdLaneCounters::~SimdLaneCounters() {
+    global_active_lane_steps += active_lane_steps;
+    global_total_lane_steps += total_lane_steps;
+}
+
+SimdLaneStats simd_lane_stats() {
+    return {CollatzLanes::LANES,
+            global_active_lane_steps.load() + simd_lane_counters.active_lane_steps,
+            global_total_lane_steps.load() + simd_lane_counters.total_lane_steps};
+}
@@ -1,34 +1,114 @@
+#include <boundedThreadPool.hpp>
 #include <threadPool.hpp>
-#include <future>
+#include <workStealingThreadPool.hpp>
+#include <atomic>
 #include <string>
 #include <vector>
 #include "collatz_fun.hpp"
+#include "coro_task.hpp"
+#include "dynamic_TP_scheduling.hpp"
+#include "scheduler.hpp"
 
 using namespace std;
 
+//fork/join over [first, last]: the range is halved until task_size elements
+//are left and the halves are joined with when_all, which never blocks a worker
+template<typename Pool, typename Reducer>
+static CoroTask<typename Reducer::value_type> split_range(Pool &tp, const Reducer &reducer, long first, long last,
+                                                          long task_size) {
+    using value_type = typename Reducer::value_type;
+    if (last - first < task_size) {
+        value_type partial = reducer.identity();
+        reducer.accumulate(partial, first, last);
+        co_return partial;
+    }
+    long middle = first + (last - first) / 2;
+    vector<CoroTask<value_type> > halves;
+    halves.push_back(split_range(tp, reducer, first, middle, task_size));
+    halves.push_back(split_range(tp, reducer, middle + 1, last, task_size));
+    co_return co_await when_all(tp, move(halves), reducer.identity(),
+                                [&reducer](value_type &acc, const value_type &other) {
+                                    reducer.combine(acc, other);
+                                });
+}
 
-void execute_dynamic_TP_scheduling(int task_size, ThreadPool &tp,
-                                   const pair<long, long> &range) {
-    auto calculate_task_maximum = [](const pair<long, long> &task_range) {
-        long local_maximum = 0;
-        //process the task (range) passed as input and return maximum within a task
-        for (long i = task_range.first; i <= task_range.second; ++i) {
-            long collatz_length = calculate_collatz_length(i);
-            local_maximum = max(local_maximum, collatz_length);
-        }
-        return local_maximum;
-    };
-
-    //divide the full range in sub-range of task_size elem and submit task to threadPool,
-    //saving the futures returned
-    vector<future<long> > local_maximum_futures;
-    for (long start = range.first; start <= range.second; start += task_size) {
-        long end_task_index = min(start + task_size - 1, range.second);
-        local_maximum_futures.emplace_back(
-            tp.enqueue(calculate_task_maximum, std::make_pair(start, end_task_index))
-        );
+//the same submission logic works for any pool exposing submit(func), wait_all(),
+//parallel_for(range, chunk, body) and current_worker()
+template<typename Pool, typename Reducer>
+static typename Reducer::value_type dynamic_TP_scheduling(int task_size, Pool &tp, const pair<long, long> &range,
+                                                          TPSubmission submission, const Reducer &reducer,
+                                                          long high_priority_tail) {
+    switch (submission) {
+        case BULK_RANGE:
+            return schedule<PoolBulkRange>(tp, range, task_size, reducer);
+        case LAZY_CHUNK_TASKS:
+            return schedule<PoolLazyChunks>(tp, range, task_size, reducer);
+        case COROUTINE_SPLIT:
+            //the halves return their values: no per-worker partials
+            if (range.first > range.second) {
+                return reducer.identity();
+            }
+            return sync_wait(tp, split_range(tp, reducer, range.first, range.second, task_size));
+        default:
+            //every task folds its chunk into the partial of the worker running it,
+            //so no future (and no shared state allocation) is needed per task
+            return schedule(tp, range, task_size, reducer, PoolChunkTasks{high_priority_tail});
     }
+}
 
-    long global_maximum = reduce_to_global_maximum(local_maximum_futures);
-    fprintf(stderr, "%ld-%ld: %ld\n", range.first, range.second, global_maximum);
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, ThreadPool &tp,
+                                                           const pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail) {
+    return dynamic_TP_scheduling(task_size, tp, range, submission, reducer, high_priority_tail);
 }
+
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, WorkStealingThreadPool &tp,
+                                                           const pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail) {
+    return dynamic_TP_scheduling(task_size, tp, range, submission, reducer, high_priority_tail);
+}
+
+template<typename Reducer>
+typename Reducer::value_type execute_dynamic_TP_scheduling(int task_size, BoundedThreadPool &tp,
+                                                           const pair<long, long> &range,
+                                                           TPSubmission submission, const Reducer &reducer,
+                                                           long high_priority_tail) {
+    return dynamic_TP_scheduling(task_size, tp, range, submission, reducer, high_priority_tail);
+}
+
+template MaxReducer::value_type execute_dynamic_TP_scheduling(int, ThreadPool &, const pair<long, long> &,
+                                                              TPSubmission, const MaxReducer &, long);
+template ArgMaxReducer::value_type execute_dynamic_TP_scheduling(int, ThreadPool &, const pair<long, long> &,
+                                                                 TPSubmission, const ArgMaxReducer &, long);
+template CollatzStatsReducer::value_type execute_dynamic_TP_scheduling(int, ThreadPool &, const pair<long, long> &,
+                                                                       TPSubmission, const CollatzStatsReducer &, long);
+template ChunkCountReducer::value_type execute_dynamic_TP_scheduling(int, ThreadPool &, const pair<long, long> &,
+                                                                     TPSubmission, const ChunkCountReducer &, long);
+template MaxReducer::value_type execute_dynamic_TP_scheduling(int, WorkStealingThreadPool &,
+                                                              const pair<long, long> &,
+                                                              TPSubmission, const MaxReducer &, long);
+template ArgMaxReducer::value_type execute_dynamic_TP_scheduling(int, WorkStealingThreadPool &,
+                                                                 const pair<long, long> &,
+                                                                 TPSubmission, const ArgMaxReducer &, long);
+template CollatzStatsReducer::value_type execute_dynamic_TP_scheduling(int, WorkStealingThreadPool &,
+                                                                       const pair<long, long> &,
+                                                                       TPSubmission, const CollatzStatsReducer &, long);
+template ChunkCountReducer::value_type execute_dynamic_TP_scheduling(int, WorkStealingThreadPool &,
+                                                                     const pair<long, long> &,
+                                                                     TPSubmission, const ChunkCountReducer &, long);
+template MaxReducer::value_type execute_dynamic_TP_scheduling(int, BoundedThreadPool &,
+                                                              const pair<long, long> &,
+                                                              TPSubmission, const MaxReducer &, long);
+template ArgMaxReducer::value_type execute_dynamic_TP_scheduling(int, BoundedThreadPool &,
+                                                                 const pair<long, long> &,
+                                                                 TPSubmission, const ArgMaxReducer &, long);
+template CollatzStatsReducer::value_type execute_dynamic_TP_scheduling(int, BoundedThreadPool &,
+                                                                       const pair<long, long> &,
+                                                                       TPSubmission, const CollatzStatsReducer &, long);
+template ChunkCountReducer::value_type execute_dynamic_TP_scheduling(int, BoundedThreadPool &,
+                                                                     const pair<long, long> &,
+                                                                     TPSubmission, const ChunkCountReducer &, long);
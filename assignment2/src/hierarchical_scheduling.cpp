@@ -0,0 +1,36 @@
+#include "hierarchical_scheduling.hpp"
+#include <algorithm>
+#include <set>
+#include <utility>
+#include "collatz_fun.hpp"
+#include "thread_affinity.hpp"
+
+using namespace std;
+
+int default_dispatch_groups(int num_threads) {
+    set<pair<int, int> > domains;
+    for (const auto &cpu: available_cpus()) {
+        domains.emplace(cpu.node, cpu.package);
+    }
+    int groups = max<int>(domains.size(), (num_threads + 7) / 8);
+    return max(1, min(groups, num_threads));
+}
+
+template<typename Reducer>
+typename Reducer::value_type execute_hierarchical_scheduling(int task_size, int num_groups, ThreadTeam &team,
+                                                             const pair<long, long> &range,
+                                                             const Reducer &reducer) {
+    return schedule<HierarchicalIndex>(team, range, task_size, reducer, HierarchicalIndex{num_groups});
+}
+
+template MaxReducer::value_type execute_hierarchical_scheduling(int, int, ThreadTeam &, const pair<long, long> &,
+                                                                const MaxReducer &);
+template ArgMaxReducer::value_type execute_hierarchical_scheduling(int, int, ThreadTeam &,
+                                                                   const pair<long, long> &,
+                                                                   const ArgMaxReducer &);
+template CollatzStatsReducer::value_type execute_hierarchical_scheduling(int, int, ThreadTeam &,
+                                                                         const pair<long, long> &,
+                                                                         const CollatzStatsReducer &);
+template ChunkCountReducer::value_type execute_hierarchical_scheduling(int, int, ThreadTeam &,
+                                                                       const pair<long, long> &,
+                                                                       const ChunkCountReducer &);
@@ -0,0 +1,65 @@
+#include <omp.h>
+#include <utility>
+#include "openmp_scheduling.hpp"
+#include "scheduler.hpp"
+
+using namespace std;
+
+//threads of the parallel region: only size() is needed by schedule()
+struct OpenMPThreads {
+    int num_threads;
+
+    int size() const { return num_threads; }
+};
+
+//iterations of an omp for over the chunk indices, schedule(runtime) set to
+//kind with one chunk per iteration
+struct OpenMPLoop {
+    OpenMPSchedule kind;
+
+    template<typename ChunkBody>
+    void for_each_chunk(OpenMPThreads &threads, const pair<long, long> &range, long chunk,
+                        ChunkBody &&chunk_body) const {
+        const long num_chunks = range.first <= range.second ? (range.second - range.first) / chunk + 1 : 0;
+        switch (kind) {
+            case OMP_STATIC:
+                omp_set_schedule(omp_sched_static, 1);
+                break;
+            case OMP_DYNAMIC:
+                omp_set_schedule(omp_sched_dynamic, 1);
+                break;
+            case OMP_GUIDED:
+                omp_set_schedule(omp_sched_guided, 1);
+                break;
+        }
+#pragma omp parallel num_threads(threads.size())
+        {
+            const int thread_id = omp_get_thread_num();
+            auto body = chunk_body;
+#pragma omp for schedule(runtime) nowait
+            for (long c = 0; c < num_chunks; c++) {
+                long first = range.first + c * chunk;
+                body(thread_id, first, chunk_last(first, chunk, range.second));
+            }
+        }
+    }
+};
+
+template<typename Reducer>
+typename Reducer::value_type execute_openmp_scheduling(int task_size, int num_threads, OpenMPSchedule kind,
+                                                       const pair<long, long> &range,
+                                                       const Reducer &reducer) {
+    OpenMPThreads threads{num_threads};
+    return schedule<OpenMPLoop>(threads, range, task_size, reducer, OpenMPLoop{kind});
+}
+
+template MaxReducer::value_type execute_openmp_scheduling(int, int, OpenMPSchedule, const pair<long, long> &,
+                                                          const MaxReducer &);
+template ArgMaxReducer::value_type execute_openmp_scheduling(int, int, OpenMPSchedule, const pair<long, long> &,
+                                                             const ArgMaxReducer &);
+template CollatzStatsReducer::value_type execute_openmp_scheduling(int, int, OpenMPSchedule,
+                                                                   const pair<long, long> &,
+                                                                   const CollatzStatsReducer &);
+template ChunkCountReducer::value_type execute_openmp_scheduling(int, int, OpenMPSchedule,
+                                                                 const pair<long, long> &,
+                                                                 const ChunkCountReducer &);
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <tbb/global_control.h>
+#include "chunk_bounds.hpp"
+#include "parallel_stl_scheduling.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+//random access iterator over the chunk indices 0, 1, ...: views::iota only
+//models an input iterator for the parallel algorithms, which would then
+//run sequentially
+class ChunkIndexIterator {
+    long index;
+
+public:
+    using iterator_category = random_access_iterator_tag;
+    using value_type = long;
+    using difference_type = ptrdiff_t;
+    using pointer = const long *;
+    using reference = long;
+
+    explicit ChunkIndexIterator(long index_ = 0) : index(index_) {}
+
+    long operator*() const { return index; }
+    long operator[](difference_type n) const { return index + n; }
+    ChunkIndexIterator &operator++() { index++; return *this; }
+    ChunkIndexIterator operator++(int) { return ChunkIndexIterator(index++); }
+    ChunkIndexIterator &operator--() { index--; return *this; }
+    ChunkIndexIterator operator--(int) { return ChunkIndexIterator(index--); }
+    ChunkIndexIterator &operator+=(difference_type n) { index += n; return *this; }
+    ChunkIndexIterator &operator-=(difference_type n) { index -= n; return *this; }
+    ChunkIndexIterator operator+(difference_type n) const { return ChunkIndexIterator(index + n); }
+    friend ChunkIndexIterator operator+(difference_type n, ChunkIndexIterator it) { return it + n; }
+    ChunkIndexIterator operator-(difference_type n) const { return ChunkIndexIterator(index - n); }
+    difference_type operator-(const ChunkIndexIterator &other) const { return index - other.index; }
+    auto operator<=>(const ChunkIndexIterator &other) const = default;
+};
+
+template<typename Reducer>
+typename Reducer::value_type execute_parallel_stl_scheduling(int task_size, int num_threads,
+                                                             const pair<long, long> &range,
+                                                             const Reducer &reducer) {
+    using value_type = typename Reducer::value_type;
+    //the standard has no thread count: -n caps the TBB workers for this call
+    tbb::global_control threads(tbb::global_control::max_allowed_parallelism, max(1, num_threads));
+    const long num_chunks = range.first <= range.second ? (range.second - range.first) / task_size + 1 : 0;
+    //no worker ids: every chunk returns its own partial, combined by the library
+    return transform_reduce(execution::par, ChunkIndexIterator(0), ChunkIndexIterator(num_chunks), reducer.identity(),
+                            [&reducer](value_type acc, const value_type &other) {
+                                reducer.combine(acc, other);
+                                return acc;
+                            },
+                            [&](long c) {
+                                long first = range.first + c * task_size;
+                                long last = chunk_last(first, task_size, range.second);
+                                TraceSpan traced("chunk", first, last);
+                                value_type partial = reducer.identity();
+                                reducer.accumulate(partial, first, last);
+                                return partial;
+                            });
+}
+
+template MaxReducer::value_type execute_parallel_stl_scheduling(int, int, const pair<long, long> &,
+                                                                const MaxReducer &);
+template ArgMaxReducer::value_type execute_parallel_stl_scheduling(int, int, const pair<long, long> &,
+                                                                   const ArgMaxReducer &);
+template CollatzStatsReducer::value_type execute_parallel_stl_scheduling(int, int, const pair<long, long> &,
+                                                                         const CollatzStatsReducer &);
+template ChunkCountReducer::value_type execute_parallel_stl_scheduling(int, int, const pair<long, long> &,
+                                                                       const ChunkCountReducer &);
@@ -1,9 +1,11 @@
 #include "parse_utility.hpp"
 #include <getopt.h>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <utility>
 #include <regex>
+#include <sstream>
 
 using namespace std;
 
@@ -20,28 +22,138 @@ pair<long, long> parseRange(const string &rangeStr) {
     return {start, end};
 }
 
-int parse_int(const char *arg, const string &option) {
+//value of option as an Integer (int or long), out of range values are
+//rejected instead of being narrowed
+template<typename Integer>
+Integer parse_integer(const char *arg, const string &option) {
+    long value = 0;
+    bool in_range;
     try {
-        return stol(arg);
+        value = stol(arg);
+        in_range = value >= numeric_limits<Integer>::min() && value <= numeric_limits<Integer>::max();
     } catch (const invalid_argument &e) {
         cerr << "Invalid argument for " << option << ": must be an integer." << endl;
         exit(EXIT_FAILURE);
     } catch (const out_of_range &e) {
-        cerr << "Out of range value for " << option << ": too big for long." << endl;
+        in_range = false;
+    }
+    if (!in_range) {
+        cerr << "Out of range value for " << option << ": must be within [" << numeric_limits<Integer>::min()
+             << ", " << numeric_limits<Integer>::max() << "]." << endl;
         exit(EXIT_FAILURE);
     }
+    return static_cast<Integer>(value);
+}
+
+CollatzKernel parse_kernel(const string &kernel) {
+    if (kernel == "plain") {
+        return PLAIN_KERNEL;
+    }
+    if (kernel == "shortcut") {
+        return SHORTCUT_KERNEL;
+    }
+    if (kernel == "table") {
+        return TABLE_KERNEL;
+    }
+    if (kernel == "simd") {
+        return SIMD_KERNEL;
+    }
+    if (kernel == "sieve") {
+        return SIEVE_KERNEL;
+    }
+    cerr << "Unknown kernel " << kernel << ": must be plain, shortcut, table, simd or sieve." << endl;
+    exit(EXIT_FAILURE);
+}
+
+OpenMPSchedule parse_omp_schedule(const string &kind) {
+    if (kind == "static") {
+        return OMP_STATIC;
+    }
+    if (kind == "dynamic") {
+        return OMP_DYNAMIC;
+    }
+    if (kind == "guided") {
+        return OMP_GUIDED;
+    }
+    cerr << "Unknown OpenMP schedule " << kind << ": must be static, dynamic or guided." << endl;
+    exit(EXIT_FAILURE);
+}
+
+BenchFormat parse_bench_format(const string &format) {
+    if (format == "json") {
+        return JSON_REPORT;
+    }
+    if (format == "csv") {
+        return CSV_REPORT;
+    }
+    cerr << "Unknown benchmark format " << format << ": must be json or csv." << endl;
+    exit(EXIT_FAILURE);
+}
+
+//compact, scatter or a cpu list such as 0,2,8-11
+void parse_pinning(const string &arg, RunningParam &runningParam) {
+    if (arg == "compact") {
+        runningParam.pinning = COMPACT_PINNING;
+        return;
+    }
+    if (arg == "scatter") {
+        runningParam.pinning = SCATTER_PINNING;
+        return;
+    }
+    regex item(R"(^(\d+)(?:-(\d+))?$)");
+    stringstream items(arg);
+    string token;
+    while (getline(items, token, ',')) {
+        smatch match;
+        if (!regex_match(token, match, item)) {
+            cerr << "Invalid argument for -p: must be compact, scatter or a cpu list (e.g. 0,2,4-7)." << endl;
+            exit(EXIT_FAILURE);
+        }
+        int first = parse_integer<int>(match[1].str().c_str(), "-p");
+        int last = match[2].matched ? parse_integer<int>(match[2].str().c_str(), "-p") : first;
+        for (int cpu = first; cpu <= last; cpu++) {
+            runningParam.cpu_list.push_back(cpu);
+        }
+    }
+    if (runningParam.cpu_list.empty()) {
+        cerr << "Invalid argument for -p: empty cpu list." << endl;
+        exit(EXIT_FAILURE);
+    }
+    runningParam.pinning = LIST_PINNING;
 }
 
 RunningParam parse_running_param(int argc, char *argv[]) {
     int opt;
-    RunningParam runningParam{16, 1, STATIC_BLOCK_CYCLING};
-    while ((opt = getopt(argc, argv, "n:c:dst")) != EOF) {
+    RunningParam runningParam{16, 1, STATIC_BLOCK_CYCLING, false, PER_CHUNK_TASKS, 0, false, 0, false, PLAIN_KERNEL,
+                              false, false, 0, false, -1, 0, false, "collatz_autotune.profile", 0, 1, JSON_REPORT, "",
+                              "", NO_PINNING, {}, OMP_STATIC, 0};
+    //long only options
+    enum {
+        AUTOTUNE_OPTION = 256,
+        PROFILE_OPTION,
+        BENCH_OPTION,
+        WARMUP_OPTION,
+        BENCH_FORMAT_OPTION,
+        BENCH_OUTPUT_OPTION,
+        TRACE_OPTION
+    };
+    const struct option long_options[] = {
+        {"autotune", no_argument, nullptr, AUTOTUNE_OPTION},
+        {"profile", required_argument, nullptr, PROFILE_OPTION},
+        {"bench", required_argument, nullptr, BENCH_OPTION},
+        {"warmup", required_argument, nullptr, WARMUP_OPTION},
+        {"bench-format", required_argument, nullptr, BENCH_FORMAT_OPTION},
+        {"bench-output", required_argument, nullptr, BENCH_OUTPUT_OPTION},
+        {"trace", required_argument, nullptr, TRACE_OPTION},
+        {nullptr, 0, nullptr, 0}
+    };
+    while ((opt = getopt_long(argc, argv, "n:c:dstwblfm:HB:vk:rp:agG:iS:q:o:eP:", long_options, nullptr)) != EOF) {
         switch (opt) {
             case 'n':
-                runningParam.num_threads = parse_int(optarg, "-n");
+                runningParam.num_threads = parse_integer<int>(optarg, "-n");
             break;
             case 'c':
-                runningParam.task_size = parse_int(optarg, "-c");
+                runningParam.task_size = parse_integer<int>(optarg, "-c");
             break;
             case 'd':
                 runningParam.scheduling_policy = DYNAMIC_WITH_INDEX;
@@ -52,11 +164,119 @@ RunningParam parse_running_param(int argc, char *argv[]) {
             case 's':
                 runningParam.scheduling_policy = STATIC_BLOCK_CYCLING;
             break;
+            case 'w':
+                runningParam.work_stealing = true;
+            break;
+            case 'b':
+                runningParam.tp_submission = BULK_RANGE;
+            break;
+            case 'l':
+                runningParam.tp_submission = LAZY_CHUNK_TASKS;
+            break;
+            case 'f':
+                runningParam.tp_submission = COROUTINE_SPLIT;
+            break;
+            case 'm':
+                runningParam.cache_budget_mb = parse_integer<int>(optarg, "-m");
+            break;
+            case 'H':
+                runningParam.cache_hash = true;
+            break;
+            case 'B':
+                runningParam.cache_dense_bound = parse_integer<long>(optarg, "-B");
+            break;
+            case 'v':
+                runningParam.verbose = true;
+            break;
+            case 'k':
+                runningParam.kernel = parse_kernel(optarg);
+            break;
+            case 'r':
+                runningParam.batch_ranges = true;
+            break;
+            case 'P':
+                runningParam.priority_tail = parse_integer<long>(optarg, "-P");
+            break;
+            case 'p':
+                parse_pinning(optarg, runningParam);
+            break;
+            case 'a':
+                runningParam.statistics = true;
+            break;
+            case 'g':
+                runningParam.scheduling_policy = HIERARCHICAL_INDEX;
+            break;
+            case 'G':
+                runningParam.dispatch_groups = parse_integer<int>(optarg, "-G");
+            break;
+            case 'i':
+                runningParam.pool_stats = true;
+            break;
+            case 'S':
+                runningParam.wait_spins = parse_integer<long>(optarg, "-S");
+            break;
+            case 'q':
+                runningParam.queue_capacity = parse_integer<long>(optarg, "-q");
+            break;
+            case 'o':
+                runningParam.scheduling_policy = OPENMP_LOOP;
+                runningParam.omp_schedule = parse_omp_schedule(optarg);
+            break;
+            case 'e':
+                runningParam.scheduling_policy = PARALLEL_STL;
+            break;
+            case AUTOTUNE_OPTION:
+                runningParam.autotune = true;
+            break;
+            case PROFILE_OPTION:
+                runningParam.profile_path = optarg;
+            break;
+            case BENCH_OPTION:
+                runningParam.bench_runs = parse_integer<int>(optarg, "--bench");
+            break;
+            case WARMUP_OPTION:
+                runningParam.bench_warmup = parse_integer<int>(optarg, "--warmup");
+            break;
+            case BENCH_FORMAT_OPTION:
+                runningParam.bench_format = parse_bench_format(optarg);
+            break;
+            case BENCH_OUTPUT_OPTION:
+                runningParam.bench_output = optarg;
+            break;
+            case TRACE_OPTION:
+                runningParam.trace_path = optarg;
+            break;
             default:
                 cerr << "Unknown option " << opt << endl;
             exit(EXIT_FAILURE);
         }
     }
+    if (runningParam.work_stealing &&
+        (runningParam.scheduling_policy != DYNAMIC_THREAD_POOL || runningParam.queue_capacity > 0)) {
+        //-w and -q select two different pools for -t
+        cerr << "-w needs -t and cannot be used with -q: they select the thread pool of -t." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (runningParam.tp_submission == COROUTINE_SPLIT && runningParam.queue_capacity > 0) {
+        //workers submit the halves: with a full ring they would all block
+        cerr << "-f cannot be used with -q: the bounded queue may block the workers." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (runningParam.batch_ranges && runningParam.scheduling_policy == DYNAMIC_THREAD_POOL &&
+        runningParam.tp_submission != PER_CHUNK_TASKS) {
+        //the batched pool path submits one task per chunk of all the ranges
+        cerr << "-r cannot be used with -b, -l or -f: the batched thread pool submits one task per chunk." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (runningParam.priority_tail != 0 &&
+        (runningParam.priority_tail < 0 || runningParam.scheduling_policy != DYNAMIC_THREAD_POOL ||
+         runningParam.work_stealing || runningParam.queue_capacity > 0 ||
+         runningParam.tp_submission != PER_CHUNK_TASKS || runningParam.batch_ranges)) {
+        //only the ThreadPool has priority queues, and only per-chunk tasks map onto chunks of a range
+        cerr << "-P needs -t with per-chunk tasks on the ThreadPool (not -w, -q, -b, -l, -f or -r)"
+                " and a non-negative chunk count." << endl;
+        exit(EXIT_FAILURE);
+    }
     for (int i = optind; i < argc; ++i) {
         runningParam.ranges.emplace_back(parseRange(argv[i]));
     }
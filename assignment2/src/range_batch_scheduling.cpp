@@ -0,0 +1,136 @@
+#include "range_batch_scheduling.hpp"
+#include <cstdio>
+#include <vector>
+#include "collatz_fun.hpp"
+#include "scheduler.hpp"
+
+using namespace std;
+
+RangeBatch::RangeBatch(const vector<pair<long, long> > &ranges) : ranges(ranges), total_size(0) {
+    for (const auto &range: ranges) {
+        offsets.push_back(total_size);
+        total_size += max(0L, range.second - range.first + 1);
+    }
+    offsets.push_back(total_size);
+}
+
+//one accumulator per range, each with a padded partial per worker
+template<typename Reducer>
+static vector<PerWorkerAccumulator<Reducer> > make_range_accumulators(const RangeBatch &batch,
+                                                                       const Reducer &reducer,
+                                                                       size_t num_workers) {
+    return vector<PerWorkerAccumulator<Reducer> >(batch.num_ranges(),
+                                                  PerWorkerAccumulator<Reducer>(reducer, num_workers));
+}
+
+template<typename Reducer>
+static vector<typename Reducer::value_type> range_results(
+    const vector<PerWorkerAccumulator<Reducer> > &accumulators) {
+    vector<typename Reducer::value_type> results;
+    for (const auto &accumulator: accumulators) {
+        results.push_back(accumulator.result());
+    }
+    return results;
+}
+
+//fold the pieces of [global_first, global_last] into the partials of worker_id
+template<typename Reducer>
+static void process_global_chunk(const RangeBatch &batch, long global_first, long global_last,
+                                 vector<PerWorkerAccumulator<Reducer> > &accumulators, size_t worker_id) {
+    batch.for_each_piece(global_first, global_last, [&](size_t r, long first, long last) {
+        TraceSpan traced("chunk", first, last);
+        accumulators[r].accumulate(worker_id, first, last);
+    });
+}
+
+//schedule<Policy> over the global index space: policy hands out the chunks
+//of [0, batch.size()) as for a single range, and every chunk is folded into
+//the accumulators of the ranges it covers instead of a single one
+template<typename Policy, typename Executor, typename Reducer>
+static void schedule_batch(Executor &executor, const RangeBatch &batch, long chunk,
+                           vector<PerWorkerAccumulator<Reducer> > &accumulators, const Policy &policy = Policy()) {
+    policy.for_each_chunk(executor, {0, batch.size() - 1}, chunk,
+                          [&batch, &accumulators](auto worker_id, long first, long last) {
+                              process_global_chunk(batch, first, last, accumulators, worker_id);
+                          });
+}
+
+template<typename Reducer>
+vector<typename Reducer::value_type> execute_batched_scheduling(SchedulingPolicy policy, int task_size,
+                                                                ThreadTeam &team,
+                                                                const vector<pair<long, long> > &ranges,
+                                                                const Reducer &reducer, int num_groups) {
+    RangeBatch batch(ranges);
+    auto accumulators = make_range_accumulators(batch, reducer, team.size());
+
+    //one run of the team for all the ranges
+    if (policy == STATIC_BLOCK_CYCLING) {
+        schedule_batch<StaticBlockCyclic>(team, batch, task_size, accumulators);
+    } else if (policy == HIERARCHICAL_INDEX) {
+        schedule_batch(team, batch, task_size, accumulators, HierarchicalIndex{num_groups});
+    } else {
+        schedule_batch<DynamicIndex>(team, batch, task_size, accumulators);
+    }
+
+    return range_results(accumulators);
+}
+
+template<typename Pool, typename Reducer>
+static vector<typename Reducer::value_type> batched_TP_scheduling(int task_size, Pool &tp,
+                                                                  const vector<pair<long, long> > &ranges,
+                                                                  const Reducer &reducer) {
+    RangeBatch batch(ranges);
+    auto accumulators = make_range_accumulators(batch, reducer, tp.size());
+
+    //one task per global chunk, a chunk crossing a range boundary folds
+    //each of its pieces into the partials of its own range
+    schedule_batch<PoolChunkTasks>(tp, batch, task_size, accumulators);
+
+    return range_results(accumulators);
+}
+
+template<typename Reducer>
+vector<typename Reducer::value_type> execute_batched_TP_scheduling(int task_size, ThreadPool &tp,
+                                                                   const vector<pair<long, long> > &ranges,
+                                                                   const Reducer &reducer) {
+    return batched_TP_scheduling(task_size, tp, ranges, reducer);
+}
+
+template<typename Reducer>
+vector<typename Reducer::value_type> execute_batched_TP_scheduling(int task_size, WorkStealingThreadPool &tp,
+                                                                   const vector<pair<long, long> > &ranges,
+                                                                   const Reducer &reducer) {
+    return batched_TP_scheduling(task_size, tp, ranges, reducer);
+}
+
+template<typename Reducer>
+vector<typename Reducer::value_type> execute_batched_TP_scheduling(int task_size, BoundedThreadPool &tp,
+                                                                   const vector<pair<long, long> > &ranges,
+                                                                   const Reducer &reducer) {
+    return batched_TP_scheduling(task_size, tp, ranges, reducer);
+}
+
+template vector<MaxReducer::value_type> execute_batched_scheduling(
+    SchedulingPolicy, int, ThreadTeam &, const vector<pair<long, long> > &, const MaxReducer &, int);
+template vector<ArgMaxReducer::value_type> execute_batched_scheduling(
+    SchedulingPolicy, int, ThreadTeam &, const vector<pair<long, long> > &, const ArgMaxReducer &, int);
+template vector<MaxReducer::value_type> execute_batched_TP_scheduling(
+    int, ThreadPool &, const vector<pair<long, long> > &, const MaxReducer &);
+template vector<ArgMaxReducer::value_type> execute_batched_TP_scheduling(
+    int, ThreadPool &, const vector<pair<long, long> > &, const ArgMaxReducer &);
+template vector<MaxReducer::value_type> execute_batched_TP_scheduling(
+    int, WorkStealingThreadPool &, const vector<pair<long, long> > &, const MaxReducer &);
+template vector<ArgMaxReducer::value_type> execute_batched_TP_scheduling(
+    int, WorkStealingThreadPool &, const vector<pair<long, long> > &, const ArgMaxReducer &);
+template vector<CollatzStatsReducer::value_type> execute_batched_scheduling(
+    SchedulingPolicy, int, ThreadTeam &, const vector<pair<long, long> > &, const CollatzStatsReducer &, int);
+template vector<CollatzStatsReducer::value_type> execute_batched_TP_scheduling(
+    int, ThreadPool &, const vector<pair<long, long> > &, const CollatzStatsReducer &);
+template vector<CollatzStatsReducer::value_type> execute_batched_TP_scheduling(
+    int, WorkStealingThreadPool &, const vector<pair<long, long> > &, const CollatzStatsReducer &);
+template vector<MaxReducer::value_type> execute_batched_TP_scheduling(
+    int, BoundedThreadPool &, const vector<pair<long, long> > &, const MaxReducer &);
+template vector<ArgMaxReducer::value_type> execute_batched_TP_scheduling(
+    int, BoundedThreadPool &, const vector<pair<long, long> > &, const ArgMaxReducer &);
+template vector<CollatzStatsReducer::value_type> execute_batched_TP_scheduling(
+    int, BoundedThreadPool &, const vector<pair<long, long> > &, const CollatzStatsReducer &);
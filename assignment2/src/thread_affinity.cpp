@@ -0,0 +1,129 @@
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <string>
+#include <tuple>
+
+using namespace std;
+
+static int read_topology_value(int cpu, const string &name) {
+    ifstream file("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/" + name);
+    int value = 0;
+    if (!(file >> value)) {
+        return 0;
+    }
+    return value;
+}
+
+//the cpu directory holds a "nodeN" link to its NUMA node
+static int read_numa_node(int cpu) {
+    string path = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+    int node = 0;
+    while (dirent *entry = readdir(dir)) {
+        if (sscanf(entry->d_name, "node%d", &node) == 1) {
+            break;
+        }
+        node = 0;
+    }
+    closedir(dir);
+    return node;
+}
+
+vector<CpuTopology> available_cpus() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    vector<CpuTopology> cpus;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back({cpu, read_numa_node(cpu), read_topology_value(cpu, "physical_package_id"),
+                            read_topology_value(cpu, "core_id")});
+        }
+    }
+    return cpus;
+}
+
+//cpus in compact or scatter order
+static vector<int> order_cpus(ThreadPinning pinning, vector<CpuTopology> cpus) {
+    vector<int> cpu_map;
+    //siblings of a core are adjacent, cores of a socket are adjacent
+    sort(cpus.begin(), cpus.end(), [](const CpuTopology &a, const CpuTopology &b) {
+        return tie(a.node, a.package, a.core, a.cpu) < tie(b.node, b.package, b.core, b.cpu);
+    });
+    if (pinning == COMPACT_PINNING) {
+        for (const auto &cpu: cpus) {
+            cpu_map.push_back(cpu.cpu);
+        }
+        return cpu_map;
+    }
+
+    //scatter: rank every cpu by (SMT sibling index, core index within its
+    //node/socket, node/socket) so that consecutive threads land on different
+    //sockets first, then on different cores
+    map<pair<int, int>, int> domain_index;
+    for (const auto &cpu: cpus) {
+        domain_index.emplace(make_pair(cpu.node, cpu.package), domain_index.size());
+    }
+    vector<tuple<int, int, int, int> > ranked;
+    int core_index = -1;
+    int sibling_index = 0;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        bool new_domain = i == 0 || cpus[i].node != cpus[i - 1].node || cpus[i].package != cpus[i - 1].package;
+        if (new_domain) {
+            core_index = -1;
+        }
+        if (new_domain || cpus[i].core != cpus[i - 1].core) {
+            core_index++;
+            sibling_index = 0;
+        } else {
+            sibling_index++;
+        }
+        ranked.emplace_back(sibling_index, core_index, domain_index[{cpus[i].node, cpus[i].package}], cpus[i].cpu);
+    }
+    sort(ranked.begin(), ranked.end());
+    for (const auto &cpu: ranked) {
+        cpu_map.push_back(get<3>(cpu));
+    }
+    return cpu_map;
+}
+
+vector<int> build_cpu_map(ThreadPinning pinning, const vector<int> &cpu_list) {
+    if (pinning == LIST_PINNING) {
+        return cpu_list;
+    }
+    if (pinning == NO_PINNING) {
+        return {};
+    }
+    return order_cpus(pinning, available_cpus());
+}
+
+void print_cpu_map(const vector<int> &cpu_map, int num_threads) {
+    if (cpu_map.empty()) {
+        printf("pinning: none\n");
+        return;
+    }
+    map<int, CpuTopology> topology;
+    for (const auto &cpu: available_cpus()) {
+        topology[cpu.cpu] = cpu;
+    }
+    for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+        int cpu = cpu_map[thread_id % cpu_map.size()];
+        auto known = topology.find(cpu);
+        if (known == topology.end()) {
+            printf("pinning: thread %d -> cpu %d (not available)\n", thread_id, cpu);
+        } else {
+            printf("pinning: thread %d -> cpu %d (node %d, package %d, core %d)\n", thread_id, cpu,
+                   known->second.node, known->second.package, known->second.core);
+        }
+    }
+}
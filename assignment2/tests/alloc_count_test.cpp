@@ -0,0 +1,64 @@
+// Checks that ThreadPool::submit performs no heap allocation per task once
+// the pool has warmed up, by counting calls to the global operator new.
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "threadPool.hpp"
+
+static std::atomic<long> allocations{0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+int main() {
+    const int num_tasks = 100000;
+    std::vector<long> slots(num_tasks, 0);
+    ThreadPool tp(4);
+
+    auto submit_all = [&]() {
+        for (int i = 0; i < num_tasks; ++i) {
+            long *slot = &slots[i];
+            tp.submit([slot, i] { *slot = i; });
+        }
+        tp.wait_all();
+    };
+
+    //warm-up: hold the workers until every task is queued, so that the
+    //task ring reaches the largest depth the measured round can need
+    std::atomic<bool> all_queued{false};
+    for (int i = 0; i < 4; ++i)
+        tp.submit([&all_queued] { while (!all_queued.load()) std::this_thread::yield(); });
+    for (int i = 0; i < num_tasks; ++i)
+        tp.submit([] {});
+    all_queued = true;
+    tp.wait_all();
+
+    long before = allocations.load();
+    submit_all();
+    long after = allocations.load();
+
+    long checksum = 0;
+    for (long value: slots)
+        checksum += value;
+
+    if (after - before == 0 && checksum == (long) num_tasks * (num_tasks - 1) / 2) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: %ld allocations for %d tasks\n", after - before, num_tasks);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,76 @@
+// Checks that every scheduling policy covers a range ending on LONG_MAX
+// exactly once, for chunk sizes that do and do not divide it: the chunk
+// bounds and the loop steps must not run past LONG_MAX (the test hangs or
+// fails when they wrap).
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include "scheduler.hpp"
+#include "threadPool.hpp"
+#include "thread_team.hpp"
+
+//elements and chunks seen, and whether a chunk fell outside the range
+struct Coverage {
+    long elements;
+    long chunks;
+    bool outside;
+};
+
+struct CoverageReducer {
+    using value_type = Coverage;
+    std::pair<long, long> range;
+
+    Coverage identity() const { return {0, 0, false}; }
+
+    void accumulate(Coverage &coverage, long first, long last) const {
+        coverage.elements += last - first + 1;
+        coverage.chunks++;
+        coverage.outside |= first > last || first < range.first || last > range.second;
+    }
+
+    void combine(Coverage &coverage, const Coverage &other) const {
+        coverage.elements += other.elements;
+        coverage.chunks += other.chunks;
+        coverage.outside |= other.outside;
+    }
+};
+
+static long failures = 0;
+
+static void check(const char *policy, const std::pair<long, long> &range, long chunk, const Coverage &coverage) {
+    const long elements = range.second - range.first + 1;
+    const long chunks = (elements + chunk - 1) / chunk;
+    if (coverage.elements != elements || coverage.chunks != chunks || coverage.outside) {
+        printf("%s %ld-%ld, chunk %ld: %ld elements in %ld chunks%s, expected %ld in %ld\n", policy,
+               range.first, range.second, chunk, coverage.elements, coverage.chunks,
+               coverage.outside ? " (some outside the range)" : "", elements, chunks);
+        failures++;
+    }
+}
+
+int main() {
+    const std::pair<long, long> ranges[] = {{LONG_MAX, LONG_MAX}, {LONG_MAX - 7, LONG_MAX},
+                                            {LONG_MAX - 1000, LONG_MAX}};
+    const long chunks[] = {1, 3, 8, 64, 5000};
+    ThreadTeam team(3);
+    ThreadPool tp(3);
+    for (const auto &range: ranges) {
+        const CoverageReducer reducer{range};
+        for (long chunk: chunks) {
+            check("static", range, chunk, schedule<StaticBlockCyclic>(team, range, chunk, reducer));
+            check("dynamic", range, chunk, schedule<DynamicIndex>(team, range, chunk, reducer));
+            check("hierarchical", range, chunk,
+                  schedule(team, range, chunk, reducer, HierarchicalIndex{2}));
+            check("pool", range, chunk, schedule<PoolChunkTasks>(tp, range, chunk, reducer));
+            check("pool bulk", range, chunk, schedule<PoolBulkRange>(tp, range, chunk, reducer));
+            check("pool lazy", range, chunk, schedule<PoolLazyChunks>(tp, range, chunk, reducer));
+        }
+    }
+    if (failures == 0) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: %ld failures\n", failures);
+    return EXIT_FAILURE;
+}
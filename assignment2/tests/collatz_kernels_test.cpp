@@ -0,0 +1,68 @@
+// Checks element by element that the kernels return the same length as the
+// 128-bit reference calculate_collatz_length_wide, that the SIMD block
+// kernel returns the same maximum on every block and that the windowed
+// sieve returns the same length for every n. Ranges can be passed on the command line
+// (same format as collatz_par), by default a few short ones are used.
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "collatz_fun.hpp"
+
+int main(int argc, char **argv) {
+    //the last ranges overflow 64 bits on the first odd step, the last two
+    //end less than a sieve window below LONG_MAX and on LONG_MAX
+    vector<pair<long, long> > ranges = {{0, 2000000}, {50000000, 51000000},
+                                        {1000000000, 1001000000},
+                                        {9000000000000000000, 9000000000000100000},
+                                        {9223372036854775000, 9223372036854775100},
+                                        {9223372036854775000, LONG_MAX}};
+    if (argc > 1) {
+        ranges.clear();
+        for (int i = 1; i < argc; ++i) {
+            ranges.emplace_back(parseRange(argv[i]));
+        }
+    }
+    const CollatzStepTable &table = collatz_step_table();
+    const long block_size = 1000;
+    long mismatches = 0;
+    for (const auto &range: ranges) {
+        //sieve lengths of the whole range, checked against the reference below
+        vector<long> sieve;
+        sieve.reserve(range.second - range.first + 1);
+        for_each_length_sieve(range.first, range.second, [&sieve](long, long length) {
+            sieve.push_back(length);
+        });
+        long block_maximum = 0;
+        for_each_in_range(range.first, range.second, [&](long n) {
+            long expected = n < 1 ? -1 : calculate_collatz_length_wide(n);
+            long plain = calculate_collatz_length(n);
+            long shortcut = calculate_collatz_length_shortcut(n);
+            long jumped = calculate_collatz_length_table(n, table);
+            long sieved = sieve[n - range.first];
+            if (plain != expected || shortcut != expected || jumped != expected || sieved != expected) {
+                if (mismatches++ < 10) {
+                    printf("n=%ld: reference %ld, plain %ld, shortcut %ld, table %ld, sieve %ld\n",
+                           n, expected, plain, shortcut, jumped, sieved);
+                }
+            }
+            //check a block every block_size elements (and at the end of the range)
+            block_maximum = max(block_maximum, expected);
+            if ((n - range.first + 1) % block_size == 0 || n == range.second) {
+                long block_first = max(range.first, n - (n - range.first) % block_size);
+                long simd_maximum = calculate_range_maximum_simd(block_first, n);
+                if (simd_maximum != block_maximum && mismatches++ < 10) {
+                    printf("block %ld-%ld: plain %ld, simd %ld\n", block_first, n, block_maximum, simd_maximum);
+                }
+                block_maximum = 0;
+            }
+        });
+    }
+    if (mismatches == 0) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: %ld mismatches\n", mismatches);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,62 @@
+// Checks the coroutine API on both pools: a recursive fork/join sum joined
+// with when_all matches the closed form (nested joins on a small pool must
+// not deadlock), and an exception thrown by a child reaches sync_wait.
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include "coro_task.hpp"
+#include "threadPool.hpp"
+#include "workStealingThreadPool.hpp"
+
+template<typename Pool>
+CoroTask<long> sum_range(Pool &pool, long first, long last) {
+    if (last - first < 16) {
+        long sum = 0;
+        for (long n = first; n <= last; n++)
+            sum += n;
+        co_return sum;
+    }
+    long middle = first + (last - first) / 2;
+    std::vector<CoroTask<long> > halves;
+    halves.push_back(sum_range(pool, first, middle));
+    halves.push_back(sum_range(pool, middle + 1, last));
+    co_return co_await when_all(pool, std::move(halves), 0L, [](long &acc, long other) { acc += other; });
+}
+
+template<typename Pool>
+CoroTask<long> failing(Pool &pool) {
+    co_await schedule_on(pool);
+    throw std::runtime_error("child failed");
+}
+
+template<typename Pool>
+CoroTask<long> join_failing(Pool &pool) {
+    std::vector<CoroTask<long> > children;
+    children.push_back(sum_range(pool, 1, 100));
+    children.push_back(failing(pool));
+    co_return co_await when_all(pool, std::move(children), 0L, [](long &acc, long other) { acc += other; });
+}
+
+template<typename Pool>
+bool check(Pool &pool) {
+    const long last = 100000;
+    bool passed = sync_wait(pool, sum_range(pool, 1, last)) == last * (last + 1) / 2;
+    try {
+        sync_wait(pool, join_failing(pool));
+        passed = false;
+    } catch (const std::runtime_error &) {
+    }
+    return passed;
+}
+
+int main() {
+    ThreadPool tp(2);
+    WorkStealingThreadPool wstp(2);
+    if (check(tp) && check(wstp)) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: wrong fork/join sum or lost exception\n");
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,49 @@
+// Checks that the lazy chunk submission (-t -l) completes on a bounded pool
+// whose ring is smaller than the tasks it would keep in flight (-q 1, 2,
+// 4, 8 with 4 threads): the refills are submitted by the workers, so a
+// full ring must never make them wait on each other (the test hangs if it
+// does). Every chunk has to be run exactly once.
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include "boundedThreadPool.hpp"
+#include "scheduler.hpp"
+
+struct ElementCountReducer {
+    using value_type = long;
+
+    long identity() const { return 0; }
+
+    void accumulate(long &elements, long first, long last) const {
+        elements += last - first + 1;
+    }
+
+    void combine(long &elements, long other) const {
+        elements += other;
+    }
+};
+
+int main() {
+    const std::pair<long, long> range = {1, 100000};
+    const long queue_capacities[] = {1, 2, 4, 8};
+    const long chunks[] = {1, 7};
+    const int rounds = 20;
+    long failures = 0;
+    for (long queue_capacity: queue_capacities) {
+        BoundedThreadPool tp(4, queue_capacity);
+        for (long chunk: chunks) {
+            for (int round = 0; round < rounds; round++) {
+                long elements = schedule<PoolLazyChunks>(tp, range, chunk, ElementCountReducer());
+                if (elements != range.second - range.first + 1 && failures++ < 10) {
+                    printf("-q %ld, chunk %ld: %ld elements\n", queue_capacity, chunk, elements);
+                }
+            }
+        }
+    }
+    if (failures == 0) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: %ld failures\n", failures);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+// Checks the priority queues of ThreadPool: with a single worker held on
+// a gate, high priority tasks queued after low priority ones run first,
+// a low priority task is never passed over more than starvation_limit
+// times in a row, and the queue wait time is recorded per priority.
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "threadPool.hpp"
+
+int main() {
+    const uint32_t starvation_limit = 4;
+    const int num_low = 10;
+    const int num_high = 100;
+    ThreadPool tp(1, starvation_limit);
+    tp.track_queue_wait(true);
+
+    std::atomic<bool> gate{false};
+    tp.submit([&gate] { while (!gate.load()) std::this_thread::yield(); });
+
+    //only the worker writes the order: no lock is needed
+    std::vector<char> order;
+    order.reserve(num_low + num_high);
+    for (int i = 0; i < num_low; ++i)
+        tp.submit_with_priority(ThreadPool::LOW_PRIORITY, [&order] { order.push_back('L'); });
+    for (int i = 0; i < num_high; ++i)
+        tp.submit_with_priority(ThreadPool::HIGH_PRIORITY, [&order] { order.push_back('H'); });
+    auto future = tp.enqueue_with_priority(ThreadPool::HIGH_PRIORITY, [] { return 42; });
+    gate = true;
+    tp.wait_all();
+
+    //the first pops are high priority, then every run of high priority tasks
+    //with low priority ones still queued is at most starvation_limit long
+    bool passed = future.get() == 42 && order.size() == (size_t) num_low + num_high && order[0] == 'H';
+    int run = 0;
+    int low_seen = 0;
+    for (char kind: order) {
+        if (kind == 'H') {
+            run++;
+            passed &= low_seen == num_low || run <= (int) starvation_limit;
+        } else {
+            run = 0;
+            low_seen++;
+        }
+    }
+
+    ThreadPool::QueueWaitStats low = tp.queue_wait_stats(ThreadPool::LOW_PRIORITY);
+    ThreadPool::QueueWaitStats high = tp.queue_wait_stats(ThreadPool::HIGH_PRIORITY);
+    passed &= low.tasks == (uint64_t) num_low && high.tasks == (uint64_t) num_high + 1;
+    passed &= low.max_wait_us > 0 && high.max_wait_us > 0;
+
+    if (passed) {
+        printf("Test passed\n");
+        return EXIT_SUCCESS;
+    }
+    printf("Error: order %.*s, wait tasks low %lu high %lu\n", (int) order.size(), order.data(),
+           (unsigned long) low.tasks, (unsigned long) high.tasks);
+    return EXIT_FAILURE;
+}